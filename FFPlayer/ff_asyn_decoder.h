@@ -3,16 +3,22 @@
 
 #include <iostream>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <assert.h>
 #include "ff_decoder_base.h"
 #include "ff_queue_base.h"
+#include "ff_seek_channel.h"
+#include "ff_reverse_reader.h"
 
 namespace FFPlayer {
 class ff_asyn_decoder: public ff_decoder_base {
 public:
+    typedef ff_safe_queue<ff_decoder_base::frame_args> frame_args_queue;
 
     ff_asyn_decoder(const char *file,
-                    std::shared_ptr<ff_safe_queue<ff_decoder_base::frame_args>>& av_queue,
+                    const std::shared_ptr<frame_args_queue>& video_queue,
+                    const std::shared_ptr<frame_args_queue>& audio_queue,
                     const unsigned int dest_width,
                     const unsigned int dest_height,
                     const unsigned int out_sample_rate):
@@ -21,12 +27,18 @@ public:
                         dest_height,
                         out_sample_rate),
         dec_thr_(),
-        av_queue_(av_queue),
+        video_queue_(video_queue),
+        audio_queue_(audio_queue),
         cancel_(false),
         seek_cb_(nullptr),
         end_decode_cb_(nullptr),
-        ended_(false) {
+        ended_(false),
+        reverse_reader_(dest_width, dest_height),
+        reverse_(false),
+        reverse_index_(-1),
+        demux_high_(0) {
         assert(file);
+        set_queue_limits();
     }
 
     bool start() {
@@ -39,31 +51,49 @@ public:
     }
 
     ~ff_asyn_decoder() {
-        if (dec_thr_.joinable())
+        reverse_reader_.interrupt();
+        join();
+        video_queue_->set_watermark_cb(nullptr);
+        audio_queue_->set_watermark_cb(nullptr);
+    }
+
+    void join() {
+        if (dec_thr_.joinable() && dec_thr_.get_id() != std::this_thread::get_id())
             dec_thr_.join();
     }
 
     void asyn_decode() {
         std::thread dec_thr([this](){
+            ff_tracer::set_thread_name("decoder");
             while(!cancel_.load()) {
-                if (seek_cb_) {
-                    if (!seek_cb_()) {
+                double seek_pos = 0.0;
+                if (seek_channel_.take(seek_pos, seek_timestamp_)) {
+                    if (seek_cb_ && !seek_cb_(seek_pos)) {
                         handle_error();
                         break;
                     }
+                    continue;
+                }
+                if (reverse_.load()) {
+                    if (!decode_reverse() && !seek_channel_.pending()) break;
+                    continue;
                 }
+                if (!wait_demux()) break;
+                if (seek_channel_.pending()) continue;
                 ff_decoder_base::frame_queue pq;
                 if (decode_packet(pq)) {
-                    for (int i = 0; i < pq.queue.size(); i++) {
-                        if (!av_queue_->enpacket_with_sort(pq.queue,[](const frame_args& fa1,
-                                                                       const frame_args& fa2){
-                            return fa1.position < fa2.position;
-                        })) {
-                            handle_error();
-                            break;
-                        }
+                    if (seek_channel_.pending()) continue;
+                    if (pq.queue.empty()) continue;
+                    const std::shared_ptr<frame_args_queue>& queue = get_queue(pq.type);
+                    ff_trace_scope trace("enqueue", pq.queue.front().position);
+                    if (!queue->enpacket_with_sort(pq.queue,[](const frame_args& fa1,
+                                                               const frame_args& fa2){
+                        return fa1.position < fa2.position;
+                    }) && !seek_channel_.pending()) {
+                        if (!queue->is_canceled()) handle_error();
+                        break;
                     }
-                } else break;
+                } else if (!is_eof() || !seek_channel_.pending()) break;
             }
             ended_.store(true);
             if (end_decode_cb_) end_decode_cb_();
@@ -75,29 +105,77 @@ public:
 
     virtual void clear_buffer() override {
         ff_decoder_base::clear_buffer();
-        av_queue_->clear();
+        video_queue_->clear();
+        audio_queue_->clear();
     }
 
     virtual void cancel() override {
+        reverse_reader_.interrupt();
         ff_decoder_base::cancel();
-        av_queue_->cancel();
+        video_queue_->cancel();
+        audio_queue_->cancel();
         cancel_.store(true);
+        wake_demux();
     }
 
     virtual void reset(const char *file) override {
         ff_decoder_base::reset(file);
+        seek_channel_.clear();
+        reverse_reader_.interrupt();
+        reverse_.store(false);
+        reverse_gop_.reset();
+        reverse_index_ = -1;
         cancel_.store(false);
-        av_queue_->reset(av_queue_->get_max_size());
+        video_queue_->reset(video_queue_->get_max_size());
+        audio_queue_->reset(audio_queue_->get_max_size());
+        {
+            std::unique_lock<std::mutex> lock(demux_m_);
+            demux_high_ = 0;
+        }
         // seek_cb_ = nullptr;
         // end_decode_cb_ = nullptr;
         ended_.store(false);
         std::cout << "decoder reset" << std::endl;
     }
 
-    void set_seek_cb(std::function<bool()> seek_cb) {
+    void set_seek_cb(std::function<bool(double)> seek_cb) {
         seek_cb_ = seek_cb;
     }
 
+    void request_seek(double pos) {
+        seek_channel_.post(pos);
+        reverse_reader_.interrupt();
+        video_queue_->interrupt();
+        audio_queue_->interrupt();
+        wake_demux();
+    }
+
+    void set_reverse(bool reverse) {
+        reverse_.store(reverse);
+    }
+
+    bool is_reverse() const {
+        return reverse_.load();
+    }
+
+    bool start_reverse(double pos) {
+        reverse_gop_.reset();
+        reverse_index_ = -1;
+        return reverse_reader_.start(get_file(), pos);
+    }
+
+    bool seek_pending() const {
+        return seek_channel_.pending();
+    }
+
+    unsigned long long get_seek_timestamp() const {
+        return seek_timestamp_;
+    }
+
+    unsigned long long get_seek_coalesced() const {
+        return seek_channel_.get_coalesced();
+    }
+
     void set_end_decode_cb(std::function<void()> end_decode_cb) {
         end_decode_cb_ = end_decode_cb;
     }
@@ -114,13 +192,107 @@ public:
         return cancel_.load();
     }
 
+    const std::shared_ptr<frame_args_queue>& get_queue(Frame_Type ft) const {
+        return ft == Audio_Frame ? audio_queue_ : video_queue_;
+    }
+
+    const std::shared_ptr<frame_args_queue>& get_video_queue() const {
+        return video_queue_;
+    }
+
+    const std::shared_ptr<frame_args_queue>& get_audio_queue() const {
+        return audio_queue_;
+    }
+
+    bool queues_empty() {
+        return video_queue_->get_empty() && audio_queue_->get_empty();
+    }
+
+    bool is_demux_paused() {
+        std::unique_lock<std::mutex> lock(demux_m_);
+        return demux_high_ != 0;
+    }
+
+private:
+    void set_queue_limits() {
+        ff_queue_meter<frame_args> meter;
+        meter.type_of = [](const frame_args& fa) {
+            return fa.ft == Video_Frame ? 0u : (fa.ft == Audio_Frame ? 1u : 2u);
+        };
+        meter.bytes_of = [](const frame_args& fa) {return (size_t)fa.size;};
+        meter.duration_of = [](const frame_args& fa) {return fa.duration;};
+        std::vector<ff_queue_limit> limits(2);
+        limits[0].max_count = ff_queue_default_video_max_count;
+        limits[0].max_bytes = ff_queue_default_video_max_bytes;
+        limits[0].max_duration = ff_queue_default_video_max_duration;
+        limits[1].max_count = ff_queue_default_audio_max_count;
+        limits[1].max_bytes = ff_queue_default_audio_max_bytes;
+        limits[1].max_duration = ff_queue_default_audio_max_duration;
+        auto watermark_cb = [this](unsigned int type, bool high) {
+            std::unique_lock<std::mutex> lock(demux_m_);
+            if (high) demux_high_ |= 1u << type;
+            else demux_high_ &= ~(1u << type);
+            demux_cv_.notify_all();
+        };
+        video_queue_->set_limits(meter, limits, ff_queue_default_low_watermark_ratio);
+        video_queue_->set_watermark_cb(watermark_cb);
+        audio_queue_->set_limits(meter, limits, ff_queue_default_low_watermark_ratio);
+        audio_queue_->set_watermark_cb(watermark_cb);
+    }
+
+    bool wait_demux() {
+        std::unique_lock<std::mutex> lock(demux_m_);
+        demux_cv_.wait(lock, [this](){
+            return !demux_high_ || cancel_.load() || seek_channel_.pending();
+        });
+        return !cancel_.load();
+    }
+
+    void wake_demux() {
+        std::unique_lock<std::mutex> lock(demux_m_);
+        demux_cv_.notify_all();
+    }
+
+    void hold_reverse_start() {
+        std::unique_lock<std::mutex> lock(demux_m_);
+        demux_cv_.wait(lock, [this](){
+            return cancel_.load() || seek_channel_.pending();
+        });
+    }
+
+    bool decode_reverse() {
+        if (!reverse_gop_ || reverse_index_ < 0) {
+            reverse_gop_.reset();
+            if (!reverse_reader_.next(reverse_gop_)) {
+                hold_reverse_start();
+                return !cancel_.load();
+            }
+            reverse_index_ = (int)reverse_gop_->frames.size()-1;
+            if (reverse_index_ < 0) return true;
+        }
+        ff_reverse_reader::frame& f = reverse_gop_->frames[reverse_index_--];
+        frame_args fa;
+        if (!append_video_picture(f.picture.data(), f.picture.size(), f.position, f.duration, fa)) return false;
+        return video_queue_->enqueue(fa);
+    }
+
 private:
     std::thread dec_thr_;
-    std::shared_ptr<ff_safe_queue<ff_decoder_base::frame_args>>& av_queue_;
+    std::shared_ptr<frame_args_queue> video_queue_;
+    std::shared_ptr<frame_args_queue> audio_queue_;
     std::atomic_bool cancel_;
-    std::function<bool()> seek_cb_;
+    std::function<bool(double)> seek_cb_;
     std::function<void()> end_decode_cb_;
     std::atomic_bool ended_;
+    ff_seek_channel seek_channel_;
+    unsigned long long seek_timestamp_ = 0;
+    ff_reverse_reader reverse_reader_;
+    std::atomic_bool reverse_;
+    std::shared_ptr<ff_reverse_reader::gop> reverse_gop_;
+    int reverse_index_;
+    std::mutex demux_m_;
+    std::condition_variable demux_cv_;
+    unsigned int demux_high_;
 };
 }
 
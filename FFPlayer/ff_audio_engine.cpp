@@ -0,0 +1,6 @@
+#include "ff_audio_engine.h"
+
+namespace FFPlayer {
+std::mutex ff_audio_engine::engine_m_;
+std::weak_ptr<ff_audio_engine> ff_audio_engine::engine_;
+}
@@ -0,0 +1,383 @@
+#ifndef FF_AUDIO_ENGINE_H
+#define FF_AUDIO_ENGINE_H
+
+#include <iostream>
+#include <portaudio.h>
+#include <string.h>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+extern "C" {
+#include <libswresample/swresample.h>
+}
+#include "ff_pcm_ring.h"
+#include "ff_audio_sink.h"
+#include "ff_audio_mixer.h"
+#include "ff_audio_format.h"
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_audio_engine {
+public:
+    class source: public ff_audio_sink {
+    public:
+        source():
+            underruns_(0),
+            overruns_(0),
+            starved_(true),
+            attached_(false) {}
+
+        ~source() {
+            stop();
+            close();
+        }
+
+        virtual bool prepare() override {
+            std::unique_lock<std::mutex> lock(m_);
+            if (!engine_) engine_ = ff_audio_engine::get_engine();
+            if (!engine_->open(channel_nb_, sample_rate_, sample_format_, frames_per_buffer_)) {
+                engine_.reset();
+                return false;
+            }
+            if (!attached_.load()) {
+                int channel_nb = 0;
+                PaSampleFormat sample_format = 0;
+                engine_->get_format(channel_nb, out_sample_rate_, sample_format);
+                frame_bytes_ = Pa_GetSampleSize(sample_format)*channel_nb;
+                ring_.reset(new ff_pcm_ring(out_sample_rate_*ring_seconds_*frame_bytes_));
+                if (!open_converter(channel_nb, sample_format)) {
+                    ring_.reset();
+                    engine_.reset();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        virtual bool start() override {
+            std::unique_lock<std::mutex> lock(m_);
+            if (!engine_ || !ring_) return false;
+            if (attached_.load()) return true;
+            if (!engine_->attach(this)) return false;
+            attached_.store(true);
+            return true;
+        }
+
+        virtual bool is_started() const override {
+            return attached_.load();
+        }
+
+        virtual bool stop() override {
+            std::unique_lock<std::mutex> lock(m_);
+            if (!attached_.load()) return true;
+            engine_->detach(this);
+            attached_.store(false);
+            return true;
+        }
+
+        virtual bool close() override {
+            std::unique_lock<std::mutex> lock(m_);
+            if (attached_.load()) return false;
+            engine_.reset();
+            close_converter();
+            return true;
+        }
+
+        virtual bool write(const void *data, size_t size) override {
+            if (!ring_) return false;
+            if (swr_context_) return convert(data, size);
+            if (ring_->write(data, size)) return true;
+            overruns_.fetch_add(1);
+            return false;
+        }
+
+        virtual void flush() override {
+            if (ring_) ring_->flush();
+        }
+
+        virtual size_t write_available() const override {
+            return ring_ ? ring_->write_available() : 0;
+        }
+
+        virtual double get_buffered_seconds() const override {
+            if (!ring_ || !frame_bytes_) return 0.0;
+            return ring_->read_available()/(double)frame_bytes_/out_sample_rate_;
+        }
+
+        virtual double get_output_latency() override {
+            std::unique_lock<std::mutex> lock(m_);
+            return engine_ ? engine_->get_output_latency() : 0.0;
+        }
+
+        virtual unsigned long long get_underruns() const override {
+            return underruns_.load();
+        }
+
+        virtual unsigned long long get_overruns() const override {
+            return overruns_.load();
+        }
+
+    private:
+        friend class ff_audio_engine;
+
+        bool open_converter(int channel_nb, PaSampleFormat sample_format) {
+            close_converter();
+            if (channel_nb == channel_nb_ &&
+                out_sample_rate_ == sample_rate_ &&
+                sample_format == sample_format_) return true;
+            swr_context_ = swr_alloc_set_opts(NULL,
+                                              ff_audio_format::get_layout_for_channels(channel_nb),
+                                              ff_audio_format::from_pa_format(sample_format),
+                                              (int)out_sample_rate_,
+                                              ff_audio_format::get_layout_for_channels(channel_nb_),
+                                              ff_audio_format::from_pa_format(sample_format_),
+                                              (int)sample_rate_,
+                                              0,
+                                              NULL);
+            if (!swr_context_ || swr_init(swr_context_) < 0) {
+                std::cout << "audio engine source can't convert to the engine format." << std::endl;
+                close_converter();
+                return false;
+            }
+            return true;
+        }
+
+        void close_converter() {
+            if (swr_context_) swr_free(&swr_context_);
+            swr_context_ = NULL;
+        }
+
+        bool convert(const void *data, size_t size) {
+            size_t in_frame_bytes = get_frame_bytes();
+            int in_samples = size/in_frame_bytes;
+            if (in_samples <= 0) return true;
+            int out_samples = swr_get_out_samples(swr_context_, in_samples);
+            if (out_samples <= 0) return true;
+            if (ring_->write_available() < out_samples*frame_bytes_) {
+                overruns_.fetch_add(1);
+                return false;
+            }
+            converted_.resize(out_samples*frame_bytes_);
+            uint8_t *out = converted_.data();
+            const uint8_t *in = (const uint8_t *)data;
+            out_samples = swr_convert(swr_context_, &out, out_samples, &in, in_samples);
+            if (out_samples < 0) return false;
+            return ring_->write(converted_.data(), out_samples*frame_bytes_);
+        }
+
+        size_t pull(void *data, size_t size) {
+            size_t nb = ring_->read(data, size);
+            nb -= nb%frame_bytes_;
+            if (nb < size && (nb || !starved_)) underruns_.fetch_add(1, std::memory_order_relaxed);
+            starved_ = nb < size;
+            return nb;
+        }
+
+    private:
+        source(const source&);
+        source& operator =(const source&);
+        std::mutex m_;
+        std::shared_ptr<ff_audio_engine> engine_;
+        double out_sample_rate_ = 0.0;
+        size_t frame_bytes_ = 0;
+        SwrContext *swr_context_ = NULL;
+        std::vector<uint8_t> converted_;
+        std::unique_ptr<ff_pcm_ring> ring_;
+        std::atomic_ullong underruns_;
+        std::atomic_ullong overruns_;
+        bool starved_;
+        std::atomic_bool attached_;
+    };
+
+    static std::shared_ptr<ff_audio_engine> get_engine() {
+        std::unique_lock<std::mutex> lock(engine_m_);
+        std::shared_ptr<ff_audio_engine> engine = engine_.lock();
+        if (engine) return engine;
+        engine.reset(new ff_audio_engine(ff_audio_engine_default_max_sources,
+                                         ff_audio_engine_default_chunk_frames));
+        engine_ = engine;
+        return engine;
+    }
+
+    ~ff_audio_engine() {
+        close();
+    }
+
+    bool open(int channel_nb,
+              double sample_rate,
+              PaSampleFormat sample_format,
+              unsigned long frames_per_buffer) {
+        std::unique_lock<std::mutex> lock(m_);
+        if (stream_) return true;
+        if (sample_format != paInt16 && sample_format != paFloat32) return false;
+        err_ = Pa_Initialize();
+        if (errored()) {
+            handle_err();
+            return false;
+        }
+        initialized_ = true;
+        channel_nb_ = channel_nb;
+        sample_rate_ = sample_rate;
+        sample_format_ = sample_format;
+        frame_bytes_ = Pa_GetSampleSize(sample_format)*channel_nb;
+        scratch_.assign(chunk_frames_*frame_bytes_, 0);
+        PaStreamParameters output_parameters;
+        output_parameters.device = Pa_GetDefaultOutputDevice();
+        output_parameters.channelCount = channel_nb;
+        output_parameters.sampleFormat = sample_format;
+        output_parameters.suggestedLatency = Pa_GetDeviceInfo(output_parameters.device)->defaultLowOutputLatency;
+        output_parameters.hostApiSpecificStreamInfo = NULL;
+        err_ = Pa_OpenStream(
+                    &stream_,
+                    NULL,
+                    &output_parameters,
+                    sample_rate,
+                    frames_per_buffer,
+                    paClipOff,
+                    &ff_audio_engine::stream_callback,
+                    this);
+        if (errored()) {
+            stream_ = NULL;
+            handle_err();
+            return false;
+        }
+        err_ = Pa_StartStream(stream_);
+        if (errored()) {
+            handle_err();
+            Pa_CloseStream(stream_);
+            stream_ = NULL;
+            return false;
+        }
+        return true;
+    }
+
+    void get_format(int& channel_nb, double& sample_rate, PaSampleFormat& sample_format) {
+        std::unique_lock<std::mutex> lock(m_);
+        channel_nb = channel_nb_;
+        sample_rate = sample_rate_;
+        sample_format = sample_format_;
+    }
+
+    bool attach(source *s) {
+        for (unsigned int i = 0; i < max_sources_; i++) {
+            source *expected = nullptr;
+            if (sources_[i].compare_exchange_strong(expected, s)) return true;
+        }
+        std::cout << "audio engine has no free source slot." << std::endl;
+        return false;
+    }
+
+    void detach(source *s) {
+        for (unsigned int i = 0; i < max_sources_; i++) {
+            source *expected = s;
+            if (sources_[i].compare_exchange_strong(expected, nullptr)) break;
+        }
+        unsigned long long seq = callback_seq_.load();
+        if (!(seq&1)) return;
+        while (callback_seq_.load() == seq) std::this_thread::yield();
+    }
+
+    unsigned int get_source_nb() const {
+        unsigned int nb = 0;
+        for (unsigned int i = 0; i < max_sources_; i++) if (sources_[i].load()) nb++;
+        return nb;
+    }
+
+    double get_output_latency() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (!stream_) return 0.0;
+        const PaStreamInfo *info = Pa_GetStreamInfo(stream_);
+        return info ? info->outputLatency : 0.0;
+    }
+
+    unsigned long long get_underflows() const {
+        return underflows_.load();
+    }
+
+private:
+    ff_audio_engine(unsigned int max_sources, unsigned int chunk_frames):
+        max_sources_(max_sources),
+        chunk_frames_(chunk_frames),
+        sources_(new std::atomic<source *>[max_sources]),
+        callback_seq_(0),
+        underflows_(0) {
+        for (unsigned int i = 0; i < max_sources_; i++) sources_[i].store(nullptr);
+    }
+
+    void close() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (stream_) {
+            Pa_StopStream(stream_);
+            Pa_CloseStream(stream_);
+            stream_ = NULL;
+        }
+        if (initialized_) Pa_Terminate();
+        initialized_ = false;
+    }
+
+    static int stream_callback(const void *,
+                               void *output,
+                               unsigned long frame_count,
+                               const PaStreamCallbackTimeInfo *,
+                               PaStreamCallbackFlags status_flags,
+                               void *user_data) {
+        ff_audio_engine *engine = (ff_audio_engine *)user_data;
+        engine->callback_seq_.fetch_add(1, std::memory_order_seq_cst);
+        if (status_flags&paOutputUnderflow) engine->underflows_.fetch_add(1, std::memory_order_relaxed);
+        engine->mix((uint8_t *)output, frame_count*engine->frame_bytes_);
+        engine->callback_seq_.fetch_add(1, std::memory_order_acq_rel);
+        return paContinue;
+    }
+
+    void mix(uint8_t *output, size_t size) {
+        while (size) {
+            size_t chunk = std::min(size, scratch_.size());
+            memset(output, 0, chunk);
+            for (unsigned int i = 0; i < max_sources_; i++) {
+                source *s = sources_[i].load(std::memory_order_seq_cst);
+                if (!s) continue;
+                size_t nb = s->pull(scratch_.data(), chunk);
+                float gain = s->gain_.load(std::memory_order_relaxed);
+                if (nb && gain > 0.0f) ff_audio_mixer::mix(output, scratch_.data(), nb, sample_format_, gain);
+            }
+            ff_audio_mixer::finish(output, chunk, sample_format_);
+            output += chunk;
+            size -= chunk;
+        }
+    }
+
+    inline bool errored() {
+        return (err_ != paNoError);
+    }
+
+    inline void handle_err() {
+        std::cout << Pa_GetErrorText(err_) << std::endl;
+    }
+
+private:
+    static std::mutex engine_m_;
+    static std::weak_ptr<ff_audio_engine> engine_;
+    ff_audio_engine();
+    ff_audio_engine(const ff_audio_engine&);
+    ff_audio_engine& operator =(const ff_audio_engine&);
+    std::mutex m_;
+    PaError err_ = 0;
+    PaStream *stream_ = NULL;
+    bool initialized_ = false;
+    int channel_nb_ = 0;
+    double sample_rate_ = 0.0;
+    PaSampleFormat sample_format_ = 0;
+    size_t frame_bytes_ = 0;
+    unsigned int max_sources_;
+    unsigned int chunk_frames_;
+    std::unique_ptr<std::atomic<source *>[]> sources_;
+    std::vector<uint8_t> scratch_;
+    std::atomic_ullong callback_seq_;
+    std::atomic_ullong underflows_;
+};
+}
+
+#endif // FF_AUDIO_ENGINE_H
@@ -0,0 +1 @@
+#include "ff_audio_format.h"
@@ -0,0 +1,101 @@
+#ifndef FF_AUDIO_FORMAT_H
+#define FF_AUDIO_FORMAT_H
+
+#include <iostream>
+#include <algorithm>
+#include <portaudio.h>
+extern "C" {
+#include <libavutil/avutil.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_audio_format {
+public:
+    int sample_rate = 0;
+    uint64_t channel_layout = ff_decode_default_out_channel_layout;
+    enum AVSampleFormat sample_fmt = ff_decode_deafult_out_sample_format;
+
+    int get_channel_nb() const {
+        return av_get_channel_layout_nb_channels(channel_layout);
+    }
+
+    unsigned int get_frame_bytes() const {
+        return get_channel_nb()*av_get_bytes_per_sample(sample_fmt);
+    }
+
+    double get_bytes_per_second() const {
+        return (double)sample_rate*get_frame_bytes();
+    }
+
+    PaSampleFormat get_pa_format() const {
+        return to_pa_format(sample_fmt);
+    }
+
+    static PaSampleFormat to_pa_format(enum AVSampleFormat sample_fmt) {
+        switch (sample_fmt) {
+        case AV_SAMPLE_FMT_U8: return paUInt8;
+        case AV_SAMPLE_FMT_S32: return paInt32;
+        case AV_SAMPLE_FMT_FLT: return paFloat32;
+        default: return paInt16;
+        }
+    }
+
+    static enum AVSampleFormat from_pa_format(PaSampleFormat sample_format) {
+        switch (sample_format) {
+        case paUInt8: return AV_SAMPLE_FMT_U8;
+        case paInt32: return AV_SAMPLE_FMT_S32;
+        case paFloat32: return AV_SAMPLE_FMT_FLT;
+        default: return AV_SAMPLE_FMT_S16;
+        }
+    }
+
+    static uint64_t get_layout_for_channels(int channel_nb) {
+        if (channel_nb >= 6) return AV_CH_LAYOUT_5POINT1;
+        if (channel_nb >= 2) return AV_CH_LAYOUT_STEREO;
+        return AV_CH_LAYOUT_MONO;
+    }
+
+    static ff_audio_format negotiate(int requested_sample_rate) {
+        ff_audio_format format;
+        format.sample_rate = requested_sample_rate;
+        if (!ff_audio_default_negotiate_output) {
+            if (!format.sample_rate) format.sample_rate = ff_audio_default_fallback_sample_rate;
+            return format;
+        }
+        format.channel_layout = get_layout_for_channels(ff_audio_default_max_output_channels);
+        format.sample_fmt = ff_audio_default_float_output ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16;
+        if (Pa_Initialize() != paNoError) {
+            if (!format.sample_rate) format.sample_rate = ff_audio_default_fallback_sample_rate;
+            return format;
+        }
+        PaDeviceIndex device = Pa_GetDefaultOutputDevice();
+        const PaDeviceInfo *info = device == paNoDevice ? NULL : Pa_GetDeviceInfo(device);
+        if (info) {
+            if (!format.sample_rate) format.sample_rate = info->defaultSampleRate;
+            int channel_nb = std::min<int>(info->maxOutputChannels, ff_audio_default_max_output_channels);
+            format.channel_layout = get_layout_for_channels(channel_nb);
+            PaStreamParameters parameters;
+            parameters.device = device;
+            parameters.channelCount = format.get_channel_nb();
+            parameters.sampleFormat = format.get_pa_format();
+            parameters.suggestedLatency = info->defaultLowOutputLatency;
+            parameters.hostApiSpecificStreamInfo = NULL;
+            if (format.sample_fmt != AV_SAMPLE_FMT_S16 &&
+                Pa_IsFormatSupported(NULL, &parameters, format.sample_rate) != paFormatIsSupported) {
+                format.sample_fmt = AV_SAMPLE_FMT_S16;
+            }
+        }
+        Pa_Terminate();
+        if (!format.sample_rate) format.sample_rate = ff_audio_default_fallback_sample_rate;
+        std::cout << "audio output: " << format.sample_rate << "Hz, "
+                  << format.get_channel_nb() << " channels, "
+                  << av_get_sample_fmt_name(format.sample_fmt) << std::endl;
+        return format;
+    }
+};
+}
+
+#endif // FF_AUDIO_FORMAT_H
@@ -0,0 +1,6 @@
+#include "ff_audio_mixer.h"
+
+namespace FFPlayer {
+constexpr float ff_audio_mixer::max_gain;
+constexpr int ff_audio_mixer::gain_shift;
+}
@@ -0,0 +1,161 @@
+#ifndef FF_AUDIO_MIXER_H
+#define FF_AUDIO_MIXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <portaudio.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FF_AUDIO_MIXER_SSE2
+#endif
+
+namespace FFPlayer {
+class ff_audio_mixer {
+public:
+    static constexpr float max_gain = 3.999f;
+    static constexpr int gain_shift = 13;
+
+    static float clamp_gain(float gain) {
+        return std::max(0.0f, std::min(max_gain, gain));
+    }
+
+    static void mix_s16(int16_t *dst, const int16_t *src, size_t nb, float gain) {
+        int16_t g = (int16_t)(clamp_gain(gain)*(1 << gain_shift)+0.5f);
+        size_t i = 0;
+#ifdef FF_AUDIO_MIXER_SSE2
+        __m128i vg = _mm_set1_epi16(g);
+        for (; i+8 <= nb; i += 8) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src+i));
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst+i));
+            _mm_storeu_si128((__m128i *)(dst+i), _mm_adds_epi16(d, gain_s16(s, vg)));
+        }
+#endif
+        for (; i < nb; i++) dst[i] = saturate_s16((int32_t)dst[i]+saturate_s16((src[i]*g) >> gain_shift));
+    }
+
+    static void scale_s16(int16_t *dst, size_t nb, float gain) {
+        int16_t g = (int16_t)(clamp_gain(gain)*(1 << gain_shift)+0.5f);
+        size_t i = 0;
+#ifdef FF_AUDIO_MIXER_SSE2
+        __m128i vg = _mm_set1_epi16(g);
+        for (; i+8 <= nb; i += 8) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(dst+i));
+            _mm_storeu_si128((__m128i *)(dst+i), gain_s16(s, vg));
+        }
+#endif
+        for (; i < nb; i++) dst[i] = saturate_s16((dst[i]*g) >> gain_shift);
+    }
+
+    static void mix_f32(float *dst, const float *src, size_t nb, float gain) {
+        gain = clamp_gain(gain);
+        size_t i = 0;
+#ifdef FF_AUDIO_MIXER_SSE2
+        __m128 vg = _mm_set1_ps(gain);
+        for (; i+4 <= nb; i += 4) {
+            __m128 s = _mm_loadu_ps(src+i);
+            __m128 d = _mm_loadu_ps(dst+i);
+            _mm_storeu_ps(dst+i, _mm_add_ps(d, _mm_mul_ps(s, vg)));
+        }
+#endif
+        for (; i < nb; i++) dst[i] += src[i]*gain;
+    }
+
+    static void scale_f32(float *dst, size_t nb, float gain) {
+        gain = clamp_gain(gain);
+        size_t i = 0;
+#ifdef FF_AUDIO_MIXER_SSE2
+        __m128 vg = _mm_set1_ps(gain);
+        for (; i+4 <= nb; i += 4) _mm_storeu_ps(dst+i, _mm_mul_ps(_mm_loadu_ps(dst+i), vg));
+#endif
+        for (; i < nb; i++) dst[i] *= gain;
+    }
+
+    static void clip_f32(float *dst, size_t nb) {
+        size_t i = 0;
+#ifdef FF_AUDIO_MIXER_SSE2
+        __m128 lo = _mm_set1_ps(-1.0f);
+        __m128 hi = _mm_set1_ps(1.0f);
+        for (; i+4 <= nb; i += 4) _mm_storeu_ps(dst+i, _mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(dst+i))));
+#endif
+        for (; i < nb; i++) dst[i] = std::max(-1.0f, std::min(1.0f, dst[i]));
+    }
+
+    static void peaks_f32(const float *src, size_t nb, float& min, float& max, double& sum_sq) {
+        size_t i = 0;
+#ifdef FF_AUDIO_MIXER_SSE2
+        if (nb >= 4) {
+            __m128 vmin = _mm_set1_ps(min);
+            __m128 vmax = _mm_set1_ps(max);
+            __m128 vsum = _mm_setzero_ps();
+            for (; i+4 <= nb; i += 4) {
+                __m128 s = _mm_loadu_ps(src+i);
+                vmin = _mm_min_ps(vmin, s);
+                vmax = _mm_max_ps(vmax, s);
+                vsum = _mm_add_ps(vsum, _mm_mul_ps(s, s));
+            }
+            float lanes[4];
+            _mm_storeu_ps(lanes, vmin);
+            min = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+            _mm_storeu_ps(lanes, vmax);
+            max = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+            _mm_storeu_ps(lanes, vsum);
+            sum_sq += (double)lanes[0]+lanes[1]+lanes[2]+lanes[3];
+        }
+#endif
+        for (; i < nb; i++) {
+            min = std::min(min, src[i]);
+            max = std::max(max, src[i]);
+            sum_sq += (double)src[i]*src[i];
+        }
+    }
+
+    static bool mix(void *dst, const void *src, size_t bytes, PaSampleFormat sample_format, float gain) {
+        switch (sample_format) {
+        case paInt16:
+            mix_s16((int16_t *)dst, (const int16_t *)src, bytes/sizeof(int16_t), gain);
+            return true;
+        case paFloat32:
+            mix_f32((float *)dst, (const float *)src, bytes/sizeof(float), gain);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static bool scale(void *dst, size_t bytes, PaSampleFormat sample_format, float gain) {
+        switch (sample_format) {
+        case paInt16:
+            scale_s16((int16_t *)dst, bytes/sizeof(int16_t), gain);
+            return true;
+        case paFloat32:
+            scale_f32((float *)dst, bytes/sizeof(float), gain);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static void finish(void *dst, size_t bytes, PaSampleFormat sample_format) {
+        if (sample_format == paFloat32) clip_f32((float *)dst, bytes/sizeof(float));
+    }
+
+private:
+    static int16_t saturate_s16(int32_t v) {
+        return (int16_t)std::max<int32_t>(INT16_MIN, std::min<int32_t>(INT16_MAX, v));
+    }
+
+#ifdef FF_AUDIO_MIXER_SSE2
+    static __m128i gain_s16(__m128i s, __m128i g) {
+        __m128i lo = _mm_mullo_epi16(s, g);
+        __m128i hi = _mm_mulhi_epi16(s, g);
+        __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), gain_shift);
+        __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), gain_shift);
+        return _mm_packs_epi32(p0, p1);
+    }
+#endif
+};
+}
+
+#endif // FF_AUDIO_MIXER_H
@@ -0,0 +1,95 @@
+#ifndef FF_AUDIO_SINK_H
+#define FF_AUDIO_SINK_H
+
+#include <portaudio.h>
+#include <stddef.h>
+#include <atomic>
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_audio_sink {
+public:
+    virtual ~ff_audio_sink() {}
+
+    inline void set_channel_nb(const int channel_nb) {
+        channel_nb_ = channel_nb;
+    }
+
+    inline void set_sample_rate(const double sample_rate) {
+        sample_rate_ = sample_rate;
+    }
+
+    inline void set_sample_format(const PaSampleFormat sample_format) {
+        sample_format_ = sample_format;
+    }
+
+    inline void set_frames_per_buffer(const unsigned long frames_per_buffer) {
+        frames_per_buffer_ = frames_per_buffer;
+    }
+
+    inline void set_ring_seconds(const double ring_seconds) {
+        ring_seconds_ = ring_seconds;
+    }
+
+    inline void set_gain(const float gain) {
+        gain_.store(gain);
+    }
+
+    inline int get_channel_nb() const {
+        return channel_nb_;
+    }
+
+    inline double get_sample_rate() const {
+        return sample_rate_;
+    }
+
+    inline PaSampleFormat get_sample_format() const {
+        return sample_format_;
+    }
+
+    inline unsigned long get_frames_per_buffer() const {
+        return frames_per_buffer_;
+    }
+
+    inline double get_ring_seconds() const {
+        return ring_seconds_;
+    }
+
+    inline float get_gain() const {
+        return gain_.load();
+    }
+
+    inline size_t get_frame_bytes() const {
+        switch (sample_format_) {
+        case paFloat32:
+        case paInt32: return 4*channel_nb_;
+        case paInt16: return 2*channel_nb_;
+        case paUInt8: return channel_nb_;
+        default: return 0;
+        }
+    }
+
+    virtual bool prepare() = 0;
+    virtual bool start() = 0;
+    virtual bool is_started() const = 0;
+    virtual bool stop() = 0;
+    virtual bool close() = 0;
+    virtual bool write(const void *data, size_t size) = 0;
+    virtual void flush() {}
+    virtual size_t write_available() const = 0;
+    virtual double get_output_latency() {return 0.0;}
+    virtual double get_buffered_seconds() const {return 0.0;}
+    virtual unsigned long long get_underruns() const {return 0;}
+    virtual unsigned long long get_overruns() const {return 0;}
+
+protected:
+    int channel_nb_ = 0;
+    double sample_rate_ = 0.0;
+    PaSampleFormat sample_format_ = 0;
+    unsigned long frames_per_buffer_ = paFramesPerBufferUnspecified;
+    double ring_seconds_ = ff_audio_default_ring_seconds;
+    std::atomic<float> gain_ {1.0f};
+};
+}
+
+#endif // FF_AUDIO_SINK_H
@@ -0,0 +1,175 @@
+#ifndef FF_AUDIO_TEMPO_H
+#define FF_AUDIO_TEMPO_H
+
+#include <assert.h>
+#include <iostream>
+#include <string>
+#include <functional>
+#include <cmath>
+#include <inttypes.h>
+extern "C" {
+#include <libavutil/avutil.h>
+#include <libavfilter/avfilter.h>
+#include <libavfilter/buffersrc.h>
+#include <libavfilter/buffersink.h>
+}
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_audio_tempo {
+public:
+    ff_audio_tempo() {}
+
+    ~ff_audio_tempo() {close();}
+
+    bool is_open(double rate,
+                 enum AVSampleFormat in_sample_fmt,
+                 int in_sample_rate,
+                 uint64_t in_ch_layout) const {
+        return graph_ &&
+               !flushed_ &&
+               rate_ == rate &&
+               in_sample_fmt_ == in_sample_fmt &&
+               in_sample_rate_ == in_sample_rate &&
+               in_ch_layout_ == in_ch_layout;
+    }
+
+    bool open(double rate,
+              enum AVSampleFormat in_sample_fmt,
+              int in_sample_rate,
+              uint64_t in_ch_layout,
+              int in_channels,
+              enum AVSampleFormat out_sample_fmt,
+              int out_sample_rate,
+              uint64_t out_ch_layout) {
+        close();
+        ff_register_all();
+        rate_ = rate;
+        in_sample_fmt_ = in_sample_fmt;
+        in_sample_rate_ = in_sample_rate;
+        in_ch_layout_ = in_ch_layout;
+        uint64_t ch_layout = in_ch_layout ? in_ch_layout : av_get_default_channel_layout(in_channels);
+        graph_ = avfilter_graph_alloc();
+        frame_ = av_frame_alloc();
+        if (!graph_ || !frame_) {
+            close();
+            return false;
+        }
+        char args[256] = {0};
+        snprintf(args, sizeof(args),
+                 "time_base=1/%d:sample_rate=%d:sample_fmt=%s:channel_layout=0x%" PRIx64,
+                 in_sample_rate,
+                 in_sample_rate,
+                 av_get_sample_fmt_name(in_sample_fmt),
+                 ch_layout);
+        if (avfilter_graph_create_filter(&src_, avfilter_get_by_name("abuffer"), "in", args, NULL, graph_) < 0 ||
+            avfilter_graph_create_filter(&sink_, avfilter_get_by_name("abuffersink"), "out", NULL, NULL, graph_) < 0) {
+            close();
+            return false;
+        }
+        std::string filters = get_atempo_chain(rate);
+        snprintf(args, sizeof(args),
+                 "aformat=sample_fmts=%s:sample_rates=%d:channel_layouts=0x%" PRIx64,
+                 av_get_sample_fmt_name(out_sample_fmt),
+                 out_sample_rate,
+                 out_ch_layout);
+        filters += args;
+        AVFilterInOut *outputs = avfilter_inout_alloc();
+        AVFilterInOut *inputs = avfilter_inout_alloc();
+        if (!outputs || !inputs) {
+            avfilter_inout_free(&outputs);
+            avfilter_inout_free(&inputs);
+            close();
+            return false;
+        }
+        outputs->name = av_strdup("in");
+        outputs->filter_ctx = src_;
+        outputs->pad_idx = 0;
+        outputs->next = NULL;
+        inputs->name = av_strdup("out");
+        inputs->filter_ctx = sink_;
+        inputs->pad_idx = 0;
+        inputs->next = NULL;
+        int err = avfilter_graph_parse_ptr(graph_, filters.c_str(), &inputs, &outputs, NULL);
+        avfilter_inout_free(&outputs);
+        avfilter_inout_free(&inputs);
+        if (err < 0 || avfilter_graph_config(graph_, NULL) < 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (graph_) avfilter_graph_free(&graph_);
+        if (frame_) av_frame_free(&frame_);
+        graph_ = NULL;
+        frame_ = NULL;
+        src_ = NULL;
+        sink_ = NULL;
+        rate_ = 1.0;
+        flushed_ = false;
+    }
+
+    bool convert(AVFrame *in, std::function<bool(const uint8_t *, int)> out_cb) {
+        assert(out_cb);
+        if (!graph_) return false;
+        if (av_buffersrc_add_frame_flags(src_, in, AV_BUFFERSRC_FLAG_KEEP_REF) < 0) return false;
+        return pull(out_cb);
+    }
+
+    bool flush(std::function<bool(const uint8_t *, int)> out_cb) {
+        assert(out_cb);
+        if (!graph_ || flushed_) return false;
+        flushed_ = true;
+        if (av_buffersrc_add_frame_flags(src_, NULL, 0) < 0) return false;
+        return pull(out_cb);
+    }
+
+    double get_rate() const {
+        return rate_;
+    }
+
+private:
+    bool pull(std::function<bool(const uint8_t *, int)> out_cb) {
+        while (true) {
+            int err = av_buffersink_get_frame(sink_, frame_);
+            if (err == AVERROR(EAGAIN) || err == AVERROR_EOF) return true;
+            if (err < 0) return false;
+            bool ok = out_cb(frame_->data[0], frame_->nb_samples);
+            av_frame_unref(frame_);
+            if (!ok) return false;
+        }
+    }
+
+    static std::string get_atempo_chain(double rate) {
+        std::string chain;
+        char tempo[64] = {0};
+        while (rate > 2.0) {
+            chain += "atempo=2,";
+            rate /= 2.0;
+        }
+        while (rate < 0.5) {
+            chain += "atempo=1/2,";
+            rate /= 0.5;
+        }
+        snprintf(tempo, sizeof(tempo), "atempo=%ld/1000000,", lrint(rate*1000000.0));
+        return chain+tempo;
+    }
+
+private:
+    ff_audio_tempo(const ff_audio_tempo&);
+    ff_audio_tempo& operator =(const ff_audio_tempo&);
+    AVFilterGraph *graph_ = NULL;
+    AVFilterContext *src_ = NULL;
+    AVFilterContext *sink_ = NULL;
+    AVFrame *frame_ = NULL;
+    double rate_ = 1.0;
+    bool flushed_ = false;
+    enum AVSampleFormat in_sample_fmt_ = AV_SAMPLE_FMT_NONE;
+    int in_sample_rate_ = 0;
+    uint64_t in_ch_layout_ = 0;
+};
+}
+
+#endif // FF_AUDIO_TEMPO_H
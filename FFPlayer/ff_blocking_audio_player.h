@@ -86,9 +86,15 @@ public:
             handle_err();
             return false;
         }
+        started_ = true;
         return true;
     }
 
+    inline bool is_started() {
+        std::unique_lock<std::mutex> lock(m_);
+        return started_;
+    }
+
     inline signed long write_available() {
         std::unique_lock<std::mutex> lock(m_);
         return Pa_GetStreamWriteAvailable(stream_);
@@ -107,6 +113,7 @@ public:
 
     inline bool stop() {
         std::unique_lock<std::mutex> lock(m_);
+        started_ = false;
         err_ = Pa_StopStream(stream_);
         if (errored()) {
             handle_err();
@@ -147,6 +154,7 @@ private:
     double sample_rate_ = 0.0;
     PaSampleFormat sample_format_ = 0.0;
     unsigned int frames_per_buffer_ = 0;
+    bool started_ = false;
     PaStreamParameters output_parameters_;
 };
 }
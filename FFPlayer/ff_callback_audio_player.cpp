@@ -0,0 +1 @@
+#include "ff_callback_audio_player.h"
@@ -0,0 +1,188 @@
+#ifndef FF_CALLBACK_AUDIO_PLAYER_H
+#define FF_CALLBACK_AUDIO_PLAYER_H
+
+#include <iostream>
+#include <portaudio.h>
+#include <string.h>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include "ff_pcm_ring.h"
+#include "ff_audio_sink.h"
+#include "ff_audio_mixer.h"
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_callback_audio_player: public ff_audio_sink {
+public:
+    ff_callback_audio_player():
+        underruns_(0),
+        overruns_(0),
+        starved_(true),
+        started_(false) {}
+
+    ~ff_callback_audio_player() {
+        stop();
+        close();
+    }
+
+    virtual bool prepare() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (stream_) return true;
+        err_ = Pa_Initialize();
+        if (errored()) {
+            handle_err();
+            return false;
+        }
+        initialized_ = true;
+        frame_bytes_ = Pa_GetSampleSize(sample_format_)*channel_nb_;
+        ring_.reset(new ff_pcm_ring(sample_rate_*ring_seconds_*frame_bytes_));
+        output_parameters_.device = Pa_GetDefaultOutputDevice();
+        output_parameters_.channelCount = channel_nb_;
+        output_parameters_.sampleFormat = sample_format_;
+        output_parameters_.suggestedLatency = Pa_GetDeviceInfo(output_parameters_.device)->defaultLowOutputLatency;
+        output_parameters_.hostApiSpecificStreamInfo = NULL;
+        err_ = Pa_OpenStream(
+                    &stream_,
+                    NULL,
+                    &output_parameters_,
+                    sample_rate_,
+                    frames_per_buffer_,
+                    paClipOff,
+                    &ff_callback_audio_player::stream_callback,
+                    this);
+        if (errored()) {
+            stream_ = NULL;
+            handle_err();
+            return false;
+        }
+        return true;
+    }
+
+    virtual bool start() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (!stream_) return false;
+        if (started_.load()) return true;
+        err_ = Pa_StartStream(stream_);
+        if (errored()) {
+            handle_err();
+            return false;
+        }
+        started_.store(true);
+        return true;
+    }
+
+    virtual bool is_started() const override {
+        return started_.load();
+    }
+
+    virtual bool stop() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (!stream_ || !started_.load()) return true;
+        started_.store(false);
+        err_ = Pa_StopStream(stream_);
+        if (errored()) {
+            handle_err();
+            return false;
+        }
+        return true;
+    }
+
+    virtual bool close() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (stream_) {
+            err_ = Pa_CloseStream(stream_);
+            stream_ = NULL;
+            if (errored()) {
+                handle_err();
+                return false;
+            }
+        }
+        if (initialized_) Pa_Terminate();
+        initialized_ = false;
+        return true;
+    }
+
+    virtual bool write(const void *data, size_t size) override {
+        if (!ring_) return false;
+        if (ring_->write(data, size)) return true;
+        overruns_.fetch_add(1);
+        return false;
+    }
+
+    virtual void flush() override {
+        if (ring_) ring_->flush();
+    }
+
+    virtual size_t write_available() const override {
+        return ring_ ? ring_->write_available() : 0;
+    }
+
+    virtual double get_buffered_seconds() const override {
+        if (!ring_ || !frame_bytes_) return 0.0;
+        return ring_->read_available()/(double)frame_bytes_/sample_rate_;
+    }
+
+    virtual double get_output_latency() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (!stream_) return 0.0;
+        const PaStreamInfo *info = Pa_GetStreamInfo(stream_);
+        return info ? info->outputLatency : 0.0;
+    }
+
+    virtual unsigned long long get_underruns() const override {
+        return underruns_.load();
+    }
+
+    virtual unsigned long long get_overruns() const override {
+        return overruns_.load();
+    }
+
+private:
+    static int stream_callback(const void *,
+                               void *output,
+                               unsigned long frame_count,
+                               const PaStreamCallbackTimeInfo *,
+                               PaStreamCallbackFlags status_flags,
+                               void *user_data) {
+        ff_callback_audio_player *player = (ff_callback_audio_player *)user_data;
+        size_t size = frame_count*player->frame_bytes_;
+        size_t nb = player->ring_->read(output, size);
+        float gain = player->gain_.load(std::memory_order_relaxed);
+        if (gain != 1.0f) ff_audio_mixer::scale(output, nb, player->sample_format_, gain);
+        if (nb < size) {
+            memset((uint8_t *)output+nb, 0, size-nb);
+            if (nb || !player->starved_) player->underruns_.fetch_add(1, std::memory_order_relaxed);
+        } else if (status_flags&paOutputUnderflow) {
+            player->underruns_.fetch_add(1, std::memory_order_relaxed);
+        }
+        player->starved_ = nb < size;
+        return paContinue;
+    }
+
+    inline bool errored() {
+        return (err_ != paNoError);
+    }
+
+    inline void handle_err() {
+        std::cout << Pa_GetErrorText(err_) << std::endl;
+    }
+
+private:
+    ff_callback_audio_player(const ff_callback_audio_player&);
+    ff_callback_audio_player& operator =(const ff_callback_audio_player&);
+    std::mutex m_;
+    PaError err_ = 0;
+    PaStream *stream_ = NULL;
+    bool initialized_ = false;
+    size_t frame_bytes_ = 0;
+    std::unique_ptr<ff_pcm_ring> ring_;
+    std::atomic_ullong underruns_;
+    std::atomic_ullong overruns_;
+    bool starved_;
+    std::atomic_bool started_;
+    PaStreamParameters output_parameters_;
+};
+}
+
+#endif // FF_CALLBACK_AUDIO_PLAYER_H
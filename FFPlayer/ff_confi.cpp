@@ -1,4 +1,15 @@
 #include "ff_confi.h"
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
 
 namespace FFPlayer {
  enum AVSampleFormat ff_decode_deafult_out_sample_format = AV_SAMPLE_FMT_S16;
@@ -8,8 +19,61 @@ namespace FFPlayer {
  unsigned int        ff_audio_default_output_channel_nb = 1;
  unsigned int        ff_audio_deafult_output_frames_per_buffer_nb = 512;
  unsigned int        ff_audio_default_output_bytes_nb = 2*ff_audio_deafult_output_frames_per_buffer_nb;
- uint16_t            ff_audio_default_output_fake_data[512] = {0};
- unsigned int        ff_player_queue_default_max_size = 50;
+ unsigned long       ff_audio_default_callback_frames_per_buffer_nb = paFramesPerBufferUnspecified;
+ double              ff_audio_default_ring_seconds = 0.5;
+ unsigned int        ff_audio_engine_default_max_sources = 32;
+ unsigned int        ff_audio_engine_default_chunk_frames = 1024;
+ bool                ff_audio_default_negotiate_output = true;
+ int                 ff_audio_default_max_output_channels = 2;
+ bool                ff_audio_default_float_output = true;
+ int                 ff_audio_default_fallback_sample_rate = 48000;
+ unsigned int        ff_player_queue_default_max_size = 256;
+ unsigned int        ff_queue_default_video_max_count = 50;
+ size_t              ff_queue_default_video_max_bytes = 0;
+ double              ff_queue_default_video_max_duration = 2.0;
+ unsigned int        ff_queue_default_audio_max_count = 200;
+ size_t              ff_queue_default_audio_max_bytes = 0;
+ double              ff_queue_default_audio_max_duration = 2.0;
+ double              ff_queue_default_low_watermark_ratio = 0.5;
  unsigned int        ff_player_task_pool_default_max_size = 50;
  unsigned int        ff_player_timer_default_loop_microseconds = 5;
+ double              ff_player_video_late_seconds = 0.1;
+ bool                ff_decode_default_fast_open = true;
+ int64_t             ff_decode_default_probe_size = 256*1024;
+ int64_t             ff_decode_default_analyze_duration = AV_TIME_BASE/2;
+ bool                ff_decode_default_dump_format = false;
+ bool                ff_decode_default_reuse_codec = true;
+ bool                ff_decode_default_keyframe_index = true;
+ unsigned int        ff_player_scrub_preview_divisor = 2;
+ unsigned int        ff_thumbnail_default_count = 20;
+ unsigned int        ff_thumbnail_default_max_jobs = 4096;
+ unsigned int        ff_waveform_default_buckets = 2000;
+ unsigned int        ff_waveform_default_max_jobs = 256;
+ bool                ff_metrics_default_enabled = true;
+ unsigned int        ff_metrics_default_dump_interval_ms = 0;
+ bool                ff_metrics_default_dump_json = false;
+ bool                ff_trace_default_enabled = false;
+ size_t              ff_trace_default_buffer_events = 64*1024;
+ size_t              ff_player_frame_cache_default_bytes = 64*1024*1024;
+ size_t              ff_player_gop_cache_default_bytes = 64*1024*1024;
+ double              ff_player_min_playback_rate = 0.25;
+ unsigned int        ff_decode_default_reverse_gop_depth = 2;
+ unsigned int        ff_decode_default_reverse_gop_max_frames = 120;
+ size_t              ff_decode_default_memory_budget = 32*1024*1024;
+ double              ff_decode_default_audio_buffer_seconds = 2.0;
+ double              ff_decode_default_video_buffer_seconds = 1.0;
+ double              ff_decode_default_low_watermark_ratio = 0.5;
+ size_t              ff_player_default_memory_budget = 64*1024*1024;
+ double              ff_player_max_playback_rate = 4.0;
+ const char *        ff_file_cache_default_dir = "./.ffplayer_cache";
+
+void ff_lower_thread_priority() {
+#if defined(__linux__)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+}
 }
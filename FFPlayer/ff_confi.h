@@ -4,8 +4,10 @@
 #include <QImage>
 #include <QPixmap>
 #include <portaudio.h>
+#include <mutex>
 extern "C" {
 #include <libavformat/avformat.h>
+#include <libavfilter/avfilter.h>
 }
 
 namespace FFPlayer {
@@ -16,10 +18,63 @@ extern PaSampleFormat      ff_audio_default_output_sample_format;
 extern unsigned int        ff_audio_default_output_channel_nb;
 extern unsigned int        ff_audio_deafult_output_frames_per_buffer_nb;
 extern unsigned int        ff_audio_default_output_bytes_nb;
-extern uint16_t            ff_audio_default_output_fake_data[512];
+extern unsigned long       ff_audio_default_callback_frames_per_buffer_nb;
+extern double              ff_audio_default_ring_seconds;
+extern unsigned int        ff_audio_engine_default_max_sources;
+extern unsigned int        ff_audio_engine_default_chunk_frames;
+extern bool                ff_audio_default_negotiate_output;
+extern int                 ff_audio_default_max_output_channels;
+extern bool                ff_audio_default_float_output;
+extern int                 ff_audio_default_fallback_sample_rate;
 extern unsigned int        ff_player_queue_default_max_size;
+extern unsigned int        ff_queue_default_video_max_count;
+extern size_t              ff_queue_default_video_max_bytes;
+extern double              ff_queue_default_video_max_duration;
+extern unsigned int        ff_queue_default_audio_max_count;
+extern size_t              ff_queue_default_audio_max_bytes;
+extern double              ff_queue_default_audio_max_duration;
+extern double              ff_queue_default_low_watermark_ratio;
 extern unsigned int        ff_player_task_pool_default_max_size;
 extern unsigned int        ff_player_timer_default_loop_microseconds;
+extern double              ff_player_video_late_seconds;
+extern bool                ff_decode_default_fast_open;
+extern int64_t             ff_decode_default_probe_size;
+extern int64_t             ff_decode_default_analyze_duration;
+extern bool                ff_decode_default_dump_format;
+extern bool                ff_decode_default_reuse_codec;
+extern bool                ff_decode_default_keyframe_index;
+extern unsigned int        ff_player_scrub_preview_divisor;
+extern unsigned int        ff_thumbnail_default_count;
+extern unsigned int        ff_thumbnail_default_max_jobs;
+extern unsigned int        ff_waveform_default_buckets;
+extern unsigned int        ff_waveform_default_max_jobs;
+extern bool                ff_metrics_default_enabled;
+extern unsigned int        ff_metrics_default_dump_interval_ms;
+extern bool                ff_metrics_default_dump_json;
+extern bool                ff_trace_default_enabled;
+extern size_t              ff_trace_default_buffer_events;
+extern size_t              ff_player_frame_cache_default_bytes;
+extern size_t              ff_player_gop_cache_default_bytes;
+extern double              ff_player_min_playback_rate;
+extern unsigned int        ff_decode_default_reverse_gop_depth;
+extern unsigned int        ff_decode_default_reverse_gop_max_frames;
+extern size_t              ff_decode_default_memory_budget;
+extern double              ff_decode_default_audio_buffer_seconds;
+extern double              ff_decode_default_video_buffer_seconds;
+extern double              ff_decode_default_low_watermark_ratio;
+extern size_t              ff_player_default_memory_budget;
+extern double              ff_player_max_playback_rate;
+extern const char *        ff_file_cache_default_dir;
+
+inline void ff_register_all() {
+    static std::once_flag registered;
+    std::call_once(registered, [](){
+        av_register_all();
+        avfilter_register_all();
+    });
+}
+
+void ff_lower_thread_priority();
 
 static inline double calculate_pcm_duration(double sample_rate,
                                             double channel_nb,
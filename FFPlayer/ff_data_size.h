@@ -3,6 +3,8 @@
 
 #include <assert.h>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 extern "C" {
 #include <libavformat/avformat.h>
 }
@@ -19,7 +21,6 @@ public:
         assert(capacity);
         assert(pixel_format != AV_PIX_FMT_NONE);
         unsigned int actual_bs = 0;
-        unsigned int bs = 2;
         if (pixel_format == AV_PIX_FMT_RGB24) {
             actual_bs = \
                     width*height*3*capacity;
@@ -30,11 +31,7 @@ public:
             std::cout << "This pixel format isn't supported." << std::endl;
             assert(false);
         }
-        while(true) {
-            if (bs >= actual_bs) return bs;
-            bs *= 2;
-        }
-        return bs;
+        return actual_bs;
     }
 
     static unsigned int get_audio_buffer_size(unsigned int sample_rate,
@@ -45,30 +42,29 @@ public:
         assert(capacity);
         assert(sample_format != AV_SAMPLE_FMT_NONE);
 
-        unsigned int sample_format_bytes_nb = 0;
-        if (sample_format == AV_SAMPLE_FMT_U8) sample_format_bytes_nb = 1;
-        else if (sample_format == AV_SAMPLE_FMT_S16) sample_format_bytes_nb = 2;
-        else if (sample_format == AV_SAMPLE_FMT_S32) sample_format_bytes_nb = 4;
-        else if (sample_format == AV_SAMPLE_FMT_FLT) sample_format_bytes_nb = 4;
-        else {
+        int sample_format_bytes_nb = av_get_bytes_per_sample(sample_format);
+        if (sample_format_bytes_nb <= 0) {
             std::cout << "This sample format isn't supported." << std::endl;
             assert(false);
         }
-        unsigned int channel_nb = 0;
-        if (channel_layout == AV_CH_LAYOUT_MONO) channel_nb = 1;
-        else if (channel_layout == AV_CH_LAYOUT_STEREO) channel_nb = 2;
-        else {
+        int channel_nb = av_get_channel_layout_nb_channels(channel_layout);
+        if (channel_nb <= 0) {
             std::cout << "This channel layout isn't supported." << std::endl;
             assert(false);
         }
         unsigned int actual_bs = sample_rate*channel_nb*sample_format_bytes_nb*capacity;
-        unsigned int bs = 2;
-        while(true) {
-            if (bs >= actual_bs) return bs;
-            bs *= 2;
-        }
         return actual_bs;
     }
+
+    static unsigned int get_video_frames_in_budget(unsigned int frame_size,
+                                                   double fps,
+                                                   double seconds,
+                                                   size_t budget) {
+        assert(frame_size);
+        unsigned int frames = fps > 0.0 ? (unsigned int)std::ceil(fps*seconds) : 1;
+        frames = std::min<size_t>(frames, budget/frame_size);
+        return std::max(2u, frames);
+    }
 };
 
 }
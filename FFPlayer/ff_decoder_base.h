@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <iostream>
 #include <numeric>
+#include <mutex>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
@@ -17,6 +18,11 @@ extern "C" {
 #include "ff_queue_base.h"
 #include "ff_data_size.h"
 #include "ff_confi.h"
+#include "ff_stream_info_cache.h"
+#include "ff_keyframe_index.h"
+#include "ff_audio_tempo.h"
+#include "ff_pipeline_metrics.h"
+#include "ff_tracer.h"
 
 namespace FFPlayer {
 class ff_decoder_base {
@@ -40,12 +46,14 @@ public:
             position(0.0),
             duration(0.0),
             size(0),
+            timestamp(0),
             audio_stream(NULL),
             video_stream(NULL){}
         Frame_Type ft;
         double position;
         double duration;
         unsigned int size;
+        unsigned long long timestamp;
         ff_safe_stream<int16_t> *audio_stream;
         ff_safe_stream<uint8_t> *video_stream;
     };
@@ -64,36 +72,30 @@ public:
         dest_width_(dest_width),
         dest_height_(dest_height),
         out_sample_rate_(out_sample_rate),
-        dest_audio_frame_buf_((uint8_t *)malloc(ff_data_size::get_audio_buffer_size(out_sample_rate,
-                                                                                    ff_decode_default_out_channel_layout,
-                                                                                    ff_decode_deafult_out_sample_format,
-                                                                                    2))),
+        dest_audio_frame_buf_(NULL),
         audio_fss_diff_(ff_data_size::get_audio_buffer_size(out_sample_rate,
                                                             ff_decode_default_out_channel_layout,
                                                             ff_decode_deafult_out_sample_format,
                                                             1)),
-        audio_fss_capacity_(ff_data_size::get_audio_buffer_size(out_sample_rate,
-                                                                ff_decode_default_out_channel_layout,
-                                                                ff_decode_deafult_out_sample_format,
-                                                                5)),
+        audio_fss_capacity_(audio_fss_diff_*2),
         video_fss_diff_(ff_data_size::get_video_buffer_size(dest_width,
                                                             dest_height,
                                                             ff_decode_default_output_pixel_format,
                                                             1)),
-        video_fss_capacity_(ff_data_size::get_video_buffer_size(dest_width,
-                                                                dest_height,
-                                                                ff_decode_default_output_pixel_format,
-                                                                30)),
+        video_fss_capacity_(video_fss_diff_*2),
+        memory_budget_(ff_decode_default_memory_budget),
         audio_fss_(audio_fss_capacity_, audio_fss_diff_),
         video_fss_(video_fss_capacity_, video_fss_diff_)
     {
-        assert(file_);
-        assert(dest_audio_frame_buf_);
+        assert(file);
     }
 
-    ~ff_decoder_base() {free(dest_audio_frame_buf_);}
+    ~ff_decoder_base() {
+        handle_error();
+        av_freep(&dest_audio_frame_buf_);
+    }
 
-    const char *get_file() const {return file_;}
+    const char *get_file() const {return file_.c_str();}
 
     void set_file(const char *file) {
         file_ = file;
@@ -102,11 +104,14 @@ public:
     bool prepare() {
         if (find_stream_info()) {
             if (get_av_stream()) {
+                if (ff_decode_default_keyframe_index && video_stream_ >= 0)
+                    keyframe_index_ = ff_keyframe_index::asyn_build(file_.c_str());
                 print_av_info();
                 if (get_audio_stream() >= 0) {
                     if (open_audio_codec()) {
                         set_video_time_base();
                         set_fps();
+                        audio_seek_target_ = 0.0;
                     }
                 }
                 if (get_video_stream() >= 0) {
@@ -114,6 +119,7 @@ public:
                         set_audio_time_base();
                     }
                 }
+                if (!set_buffer_budget()) return false;
                 if (set_original_frame()) {
                     if (set_dest_frame()) {
                         if (set_dest_frame_buffer()) {
@@ -144,7 +150,8 @@ public:
             }
             return decode_packet(pq);
         }
-        handle_error();
+        if (eof_ && drain_audio(pq)) return true;
+        if (!eof_) handle_error();
         return false;
     }
 
@@ -152,6 +159,10 @@ public:
         return duration_;
     }
 
+    bool is_eof() const {
+        return eof_;
+    }
+
     unsigned int get_dest_width() const {
         return dest_width_;
     }
@@ -176,6 +187,60 @@ public:
         return out_sample_fmt_;
     }
 
+    bool set_audio_format(enum AVSampleFormat out_sample_fmt, uint64_t out_ch_layout) {
+        unsigned int diff = ff_data_size::get_audio_buffer_size(out_sample_rate_,
+                                                                out_ch_layout,
+                                                                out_sample_fmt,
+                                                                1);
+        if (!audio_fss_.resize(diff*2, diff)) return false;
+        out_sample_fmt_ = out_sample_fmt;
+        out_ch_layout_ = out_ch_layout;
+        audio_fss_diff_ = diff;
+        audio_fss_capacity_ = diff*2;
+        return true;
+    }
+
+    bool is_audio_passthrough() const {
+        return passthrough_;
+    }
+
+    void set_memory_budget(size_t memory_budget) {
+        memory_budget_ = memory_budget;
+    }
+
+    void set_metrics(ff_pipeline_metrics *metrics) {
+        metrics_ = metrics;
+    }
+
+    size_t get_memory_budget() const {
+        return memory_budget_;
+    }
+
+    size_t get_buffer_memory() {
+        return (size_t)audio_fss_.get_capacity()+
+               video_fss_.get_capacity()+
+               num_bytes_+
+               dest_audio_frame_buf_size_;
+    }
+
+    double get_audio_buffer_seconds() {
+        unsigned int bytes_per_second = audio_fss_diff_;
+        return (double)audio_fss_.get_high_watermark()/bytes_per_second;
+    }
+
+    double get_video_buffer_seconds() {
+        if (fps_ <= 0.0) return 0.0;
+        return (double)(video_fss_.get_high_watermark()/video_fss_diff_)/fps_;
+    }
+
+    void set_rate(double rate) {
+        rate_.store(rate);
+    }
+
+    double get_rate() const {
+        return rate_.load();
+    }
+
     bool seek_audio(const double pos) {
         int64_t ts = (int64_t)(pos/audio_time_base_);
         err_code_ = avformat_seek_file(format_context_,
@@ -189,34 +254,76 @@ public:
             return false;
         }
         avcodec_flush_buffers(audio_codec_context_);
+        audio_seek_target_ = pos;
+        reset_swr_context();
         return true;
     }
 
     bool seek_video(const double pos) {
         int64_t ts = (int64_t)(pos/video_time_base_);
-        err_code_ = avformat_seek_file(format_context_,
-                                       video_stream_,
-                                       ts,
-                                       ts,
-                                       ts,
-                                       AVSEEK_FLAG_FRAME);
+        ff_keyframe_index::entry e;
+        if (keyframe_index_ && keyframe_index_->find(pos, e)) {
+            if (!format_context_->streams[video_stream_]->nb_index_entries && e.offset >= 0) {
+                err_code_ = avformat_seek_file(format_context_,
+                                               -1,
+                                               INT64_MIN,
+                                               e.offset,
+                                               e.offset,
+                                               AVSEEK_FLAG_BYTE);
+            } else {
+                int64_t kts = (int64_t)(e.position/video_time_base_);
+                err_code_ = avformat_seek_file(format_context_,
+                                               video_stream_,
+                                               INT64_MIN,
+                                               kts,
+                                               kts,
+                                               0);
+            }
+        } else {
+            err_code_ = avformat_seek_file(format_context_,
+                                           video_stream_,
+                                           INT64_MIN,
+                                           ts,
+                                           ts,
+                                           0);
+        }
         if (err_code_ < 0) {
             handle_error();
             return false;
         }
         avcodec_flush_buffers(video_codec_context_);
+        if (audio_codec_context_) avcodec_flush_buffers(audio_codec_context_);
+        video_seek_target_ = pos;
+        audio_seek_target_ = pos;
+        video_decimate_pos_ = -1.0;
+        tempo_.close();
+        reset_swr_context();
         return true;
     }
 
     void handle_error() {
+        tempo_.close();
         if (swr_context_) {
             swr_free(&swr_context_);
             swr_context_ = NULL;
         }
+        passthrough_ = false;
         if (sws_context_) {
             sws_freeContext(sws_context_);
             sws_context_ = NULL;
         }
+        if (video_codec_context_) {
+            avcodec_free_context(&video_codec_context_);
+            video_codec_context_ = NULL;
+        }
+        if (audio_codec_context_) {
+            avcodec_free_context(&audio_codec_context_);
+            audio_codec_context_ = NULL;
+        }
+        close_input();
+    }
+
+    void close_input() {
         if (buffer_) {
             av_free(buffer_);
             buffer_ = NULL;
@@ -225,18 +332,10 @@ public:
             av_frame_free(&dest_frame_);
             dest_frame_ = NULL;
         }
-        if (video_codec_context_) {
-            avcodec_close(video_codec_context_);
-            video_codec_context_ = NULL;
-        }
         if (original_frame_) {
             av_frame_free(&original_frame_);
             original_frame_ = NULL;
         }
-        if (audio_codec_context_) {
-            avcodec_close(audio_codec_context_);
-            audio_codec_context_ = NULL;
-        }
         if (format_context_) {
             avformat_close_input(&format_context_);
             format_context_ = NULL;
@@ -244,34 +343,31 @@ public:
     }
 
     void clear() {
-        handle_error();
-        file_ = NULL;
+        if (ff_decode_default_reuse_codec) close_input();
+        else handle_error();
+        file_.clear();
         format_context_ = NULL;
         video_stream_ = -1;
         audio_stream_ = -1;
-        video_codec_context_ = NULL;
-        video_codec_ = NULL;
-        audio_codec_context_ = NULL;
-        audio_codec_ = NULL;
         original_frame_ = NULL;
         dest_frame_ = NULL;
         frame_finished_ = 0.0;
         num_bytes_ = 0.0;
         buffer_ = NULL;
         dict_ = NULL;
-        sws_context_ = NULL;
         video_time_base_ = 0.0;
         audio_time_base_ = 0.0;
         fps_ = 0.0;
-        swr_context_ = NULL;
         err_code_ = 0;
+        eof_ = false;
+        video_seek_target_ = -1.0;
+        audio_seek_target_ = -1.0;
+        video_decimate_pos_ = -1.0;
+        audio_end_position_ = 0.0;
+        tempo_.close();
+        keyframe_index_.reset();
         duration_ = 0.0;
-        in_sample_fmt_ = AV_SAMPLE_FMT_NONE;
-        out_sample_fmt_ = ff_decode_deafult_out_sample_format;
-        in_sample_rate_ = 0;
         //out_sample_rate_ = 0;
-        in_ch_layout_ = 0;
-        out_ch_layout_ = ff_decode_default_out_channel_layout;
         out_channel_nb_ = 0;
         dest_vft_ = ff_decode_default_output_pixel_format;
         //dest_width_ = 0;
@@ -299,15 +395,60 @@ public:
         video_fss_.clear_all();
     }
 
+protected:
+    bool append_video_picture(uint8_t *picture,
+                              unsigned int size,
+                              double position,
+                              double duration,
+                              frame_args& fa) {
+        if (dest_vft_ == AV_PIX_FMT_RGB24) add_watermark(picture);
+        if (!video_fss_.append(picture, size)) return false;
+        fa.ft = Video_Frame;
+        fa.position = position;
+        fa.duration = duration;
+        fa.size = size;
+        fa.video_stream = &video_fss_;
+        mark_decoded(fa);
+        return true;
+    }
+
+    ff_latency_histogram *get_histogram(ff_pipeline_metrics::Stage stage) {
+        return metrics_ ? metrics_->get_histogram(stage) : nullptr;
+    }
+
+    void mark_decoded(frame_args& fa) {
+        if (ff_tracer::enabled()) ff_tracer::instant(fa.ft == Audio_Frame ? "audio_decoded" : "video_decoded", fa.position);
+        if (!metrics_ || !metrics_->is_enabled()) return;
+        metrics_->count(ff_pipeline_metrics::Frames_Decoded);
+        fa.timestamp = ff_latency_histogram::now();
+    }
+
 private:
     bool find_stream_info() {
-        av_register_all();
+        ff_register_all();
         format_context_ = avformat_alloc_context();
-        err_code_ = avformat_open_input(&format_context_, file_, NULL, NULL);
+        AVDictionary *format_opts = NULL;
+        if (ff_decode_default_fast_open) {
+            av_dict_set_int(&format_opts, "probesize", ff_decode_default_probe_size, 0);
+            av_dict_set_int(&format_opts, "analyzeduration", ff_decode_default_analyze_duration, 0);
+        }
+        err_code_ = avformat_open_input(&format_context_, file_.c_str(), NULL, &format_opts);
+        av_dict_free(&format_opts);
         if (err_code_) {
             handle_error();
             return false;
         }
+        if (ff_decode_default_fast_open) {
+            ff_stream_info_cache sic(file_.c_str());
+            if (sic.load() && sic.apply(format_context_)) return true;
+            err_code_ = avformat_find_stream_info(format_context_, NULL);
+            if (err_code_ < 0) {
+                handle_error();
+                return false;
+            }
+            sic.store(format_context_);
+            return true;
+        }
         err_code_ = avformat_find_stream_info(format_context_, NULL);
         if (err_code_ < 0) {
             handle_error();
@@ -340,37 +481,48 @@ private:
         return true;
     }
 
-    bool open_video_codec() {
-        video_codec_context_ = format_context_->streams[video_stream_]->codec;
-        if (!video_codec_context_) {
-            handle_error();
-            return false;
+    static bool codec_context_reusable(const AVCodecContext *cc, const AVCodecContext *st_cc) {
+        if (!cc || !st_cc) return false;
+        if (cc->codec_id != st_cc->codec_id) return false;
+        if (cc->extradata_size != st_cc->extradata_size) return false;
+        if (cc->extradata_size && memcmp(cc->extradata, st_cc->extradata, cc->extradata_size)) return false;
+        if (st_cc->codec_type == AVMEDIA_TYPE_VIDEO) {
+            return cc->width == st_cc->width &&
+                   cc->height == st_cc->height &&
+                   cc->pix_fmt == st_cc->pix_fmt;
         }
-        video_codec_ = avcodec_find_decoder(video_codec_context_->codec_id);
-        if (!video_codec_) {
+        return cc->sample_rate == st_cc->sample_rate &&
+               cc->channels == st_cc->channels &&
+               cc->channel_layout == st_cc->channel_layout &&
+               cc->sample_fmt == st_cc->sample_fmt;
+    }
+
+    bool open_codec(AVCodecContext *st_cc, AVCodecContext *&codec_context, AVCodec *&codec) {
+        if (!st_cc) {
             handle_error();
             return false;
         }
-        err_code_ = avcodec_open2(video_codec_context_, video_codec_, &dict_);
-        if (err_code_ < 0) {
+        if (codec_context_reusable(codec_context, st_cc)) {
+            avcodec_flush_buffers(codec_context);
+            return true;
+        }
+        if (codec_context) avcodec_free_context(&codec_context);
+        codec = avcodec_find_decoder(st_cc->codec_id);
+        if (!codec) {
             handle_error();
             return false;
         }
-        return true;
-    }
-
-    bool open_audio_codec() {
-        audio_codec_context_ = format_context_->streams[audio_stream_]->codec;
-        if (!audio_codec_context_) {
+        codec_context = avcodec_alloc_context3(codec);
+        if (!codec_context) {
             handle_error();
             return false;
         }
-        audio_codec_ = avcodec_find_decoder(audio_codec_context_->codec_id);
-        if (!audio_codec_) {
+        err_code_ = avcodec_copy_context(codec_context, st_cc);
+        if (err_code_ < 0) {
             handle_error();
             return false;
         }
-        err_code_ = avcodec_open2(audio_codec_context_, audio_codec_, &dict_);
+        err_code_ = avcodec_open2(codec_context, codec, &dict_);
         if (err_code_ < 0) {
             handle_error();
             return false;
@@ -378,6 +530,18 @@ private:
         return true;
     }
 
+    bool open_video_codec() {
+        return open_codec(format_context_->streams[video_stream_]->codec,
+                          video_codec_context_,
+                          video_codec_);
+    }
+
+    bool open_audio_codec() {
+        return open_codec(format_context_->streams[audio_stream_]->codec,
+                          audio_codec_context_,
+                          audio_codec_);
+    }
+
     int get_video_stream() const {
         return video_stream_;
     }
@@ -419,6 +583,26 @@ private:
         }
     }
 
+    bool set_buffer_budget() {
+        size_t audio_bytes = 0;
+        if (audio_stream_ >= 0) audio_bytes = audio_fss_diff_*ff_decode_default_audio_buffer_seconds;
+        size_t video_budget = memory_budget_ > audio_bytes ? memory_budget_-audio_bytes : 0;
+        unsigned int video_frames = ff_data_size::get_video_frames_in_budget(video_fss_diff_,
+                                                                             video_stream_ >= 0 ? (fps_ > 0.0 ? fps_ : 25.0) : 0.0,
+                                                                             ff_decode_default_video_buffer_seconds,
+                                                                             video_budget);
+        unsigned int video_high = video_fss_diff_*video_frames;
+        unsigned int audio_high = std::max<size_t>(audio_bytes, audio_fss_diff_);
+        if (!video_fss_.resize(video_high+video_fss_diff_, video_fss_diff_) ||
+            !audio_fss_.resize(audio_high+audio_fss_diff_, audio_fss_diff_)) {
+            handle_error();
+            return false;
+        }
+        video_fss_.set_watermarks(video_high, video_high*ff_decode_default_low_watermark_ratio);
+        audio_fss_.set_watermarks(audio_high, audio_high*ff_decode_default_low_watermark_ratio);
+        return true;
+    }
+
     bool set_original_frame() {
         original_frame_ = av_frame_alloc();
         if (!original_frame_) {
@@ -450,16 +634,17 @@ private:
     }
 
     bool set_sws_context() {
-        sws_context_ = sws_getContext(video_codec_context_->width,
-                                      video_codec_context_->height,
-                                      video_codec_context_->pix_fmt,
-                                      dest_width_,
-                                      dest_height_,
-                                      (enum AVPixelFormat)dest_vft_,
-                                      SWS_BICUBIC,
-                                      NULL,
-                                      NULL,
-                                      NULL);
+        sws_context_ = sws_getCachedContext(sws_context_,
+                                            video_codec_context_->width,
+                                            video_codec_context_->height,
+                                            video_codec_context_->pix_fmt,
+                                            dest_width_,
+                                            dest_height_,
+                                            (enum AVPixelFormat)dest_vft_,
+                                            SWS_BICUBIC,
+                                            NULL,
+                                            NULL,
+                                            NULL);
         if (!sws_context_) {
             handle_error();
             return false;
@@ -482,19 +667,34 @@ private:
 
     bool set_swr_context() {
         if (audio_stream_ >= 0) {
+            if ((swr_context_ || passthrough_) &&
+                in_sample_fmt_ == audio_codec_context_->sample_fmt &&
+                in_sample_rate_ == audio_codec_context_->sample_rate &&
+                in_ch_layout_ == audio_codec_context_->channel_layout) {
+                out_channel_nb_ = av_get_channel_layout_nb_channels(out_ch_layout_);
+                return true;
+            }
+            if (swr_context_) swr_free(&swr_context_);
+            in_sample_fmt_ = audio_codec_context_->sample_fmt;
+            in_sample_rate_ = audio_codec_context_->sample_rate;
+            in_ch_layout_ = audio_codec_context_->channel_layout;
+            out_channel_nb_ = av_get_channel_layout_nb_channels(out_ch_layout_);
+            uint64_t in_ch_layout = in_ch_layout_ ? in_ch_layout_ :
+                                    av_get_default_channel_layout(audio_codec_context_->channels);
+            passthrough_ = in_sample_fmt_ == out_sample_fmt_ &&
+                           in_sample_rate_ == out_sample_rate_ &&
+                           in_ch_layout == out_ch_layout_;
+            if (passthrough_) return true;
             swr_context_ = swr_alloc();
             if (!swr_context_) {
                 handle_error();
                 return false;
            }
-            in_sample_fmt_ = audio_codec_context_->sample_fmt;
-            in_sample_rate_ = audio_codec_context_->sample_rate;
-            in_ch_layout_ = audio_codec_context_->channel_layout;
             swr_context_ = swr_alloc_set_opts(swr_context_,
                                          out_ch_layout_,
                                          out_sample_fmt_,
                                          out_sample_rate_,
-                                         in_ch_layout_,
+                                         in_ch_layout,
                                          in_sample_fmt_,
                                          in_sample_rate_,
                                          0,
@@ -503,16 +703,18 @@ private:
                 handle_error();
                 return false;
             }
-            out_channel_nb_ = av_get_channel_layout_nb_channels(out_ch_layout_);
         }
         return true;
     }
 
 private:
     bool read_frame() {
+        ff_latency_histogram::scope scope(get_histogram(ff_pipeline_metrics::Demux_Stage));
+        ff_trace_scope trace("demux");
         int len = av_read_frame(format_context_, &packet_);
         if (len < 0) {
-            handle_error();
+            eof_ = (len == AVERROR_EOF);
+            if (!eof_) handle_error();
             return false;
         }
         packet_size_ = packet_.size;
@@ -537,6 +739,8 @@ private:
     }
 
     int video_frame_scale() {
+        ff_latency_histogram::scope scope(get_histogram(ff_pipeline_metrics::Scale_Stage));
+        ff_trace_scope trace("scale");
         return sws_scale(sws_context_,
                   (const uint8_t* const*)original_frame_->data,
                   original_frame_->linesize,
@@ -551,25 +755,11 @@ private:
         uint8_t *frame = NULL;
         if (dest_vft_ == AV_PIX_FMT_RGB24) {
             fs = 3 * size;
-            cv::Mat img(cv::Size((int)get_dest_width(),(int)get_dest_height()),
-                        CV_8UC3,
-                        (void *)(dest_frame_->data[0]));
-            std::string text = "QMZ";
-            double text_size = 3.0;
-            int color_num = 128;
-            int text_width = 3;
-            cv::putText(img,
-                    text,
-                    cv::Point(img.cols * 0, img.rows * 0.9),
-                    cv::FONT_HERSHEY_PLAIN,
-                    text_size,
-                    cv::Scalar(color_num, color_num, color_num),
-                    text_width);
-            if (!video_fss_.append(img.data, fs)) {
+            add_watermark(dest_frame_->data[0]);
+            if (!video_fss_.append(dest_frame_->data[0], fs)) {
                 handle_error();
                 return NULL;
             }
-            img.release();
             return (uint8_t*)&video_fss_;
         } else {
             fs = size * 3 / 2;
@@ -585,9 +775,41 @@ private:
         }
     }
 
+    void add_watermark(uint8_t *picture) {
+        ff_latency_histogram::scope scope(get_histogram(ff_pipeline_metrics::Watermark_Stage));
+        ff_trace_scope trace("watermark");
+        cv::Mat img(cv::Size((int)get_dest_width(),(int)get_dest_height()),
+                    CV_8UC3,
+                    (void *)picture);
+        std::string text = "QMZ";
+        double text_size = 3.0;
+        int color_num = 128;
+        int text_width = 3;
+        cv::putText(img,
+                text,
+                cv::Point(img.cols * 0, img.rows * 0.9),
+                cv::FONT_HERSHEY_PLAIN,
+                text_size,
+                cv::Scalar(color_num, color_num, color_num),
+                text_width);
+        img.release();
+    }
+
     bool handle_video_frame(frame_args& fa) {
         double frame_position = get_video_frame_position();
         double frame_duration = get_video_frame_duration();
+        if (video_seek_target_ >= 0.0) {
+            if (frame_position+frame_duration <= video_seek_target_) return true;
+            video_seek_target_ = -1.0;
+        }
+        double rate = rate_.load();
+        if (rate > 1.0) {
+            if (frame_position < video_decimate_pos_) {
+                if (metrics_) metrics_->count(ff_pipeline_metrics::Frames_Dropped);
+                return true;
+            }
+            video_decimate_pos_ = frame_position+frame_duration*(rate-0.5);
+        }
         if (video_frame_scale() != dest_height_) {
             handle_error();
             return false;
@@ -611,6 +833,7 @@ private:
         fa.duration = frame_duration;
         fa.size = frame_size;
         fa.video_stream = &video_fss_;
+        mark_decoded(fa);
         return true;
     }
 
@@ -620,17 +843,83 @@ private:
     }
 
     double get_audio_frame_duration() {
-        return av_frame_get_pkt_duration(original_frame_) * audio_time_base_;
+        double duration = av_frame_get_pkt_duration(original_frame_) * audio_time_base_;
+        if (duration <= 0.0 && audio_codec_context_->sample_rate > 0)
+            duration = (double)original_frame_->nb_samples/audio_codec_context_->sample_rate;
+        return duration;
+    }
+
+    bool reserve_audio_frame_buf(int out_samples) {
+        int size = conver_audio_buffer_size(out_samples);
+        if (size < 0) return false;
+        av_fast_malloc(&dest_audio_frame_buf_, &dest_audio_frame_buf_size_, size);
+        return dest_audio_frame_buf_ != NULL;
     }
 
     int audio_frame_convert() {
+        int out_samples = swr_get_out_samples(swr_context_, original_frame_->nb_samples);
+        if (out_samples <= 0) return out_samples;
+        if (!reserve_audio_frame_buf(out_samples)) return AVERROR(ENOMEM);
         return swr_convert(swr_context_,
                            &dest_audio_frame_buf_,
-                           20 * 44100,
+                           out_samples,
                            (const uint8_t **)original_frame_->data,
                            original_frame_->nb_samples);
     }
 
+    void reset_swr_context() {
+        if (!swr_context_) return;
+        swr_close(swr_context_);
+        if (swr_init(swr_context_) < 0) handle_error();
+    }
+
+    bool drain_audio(frame_queue& pq) {
+        double rate = rate_.load();
+        if (rate != 1.0) return drain_tempo(rate, pq);
+        if (!swr_context_) return false;
+        int out_samples = swr_get_out_samples(swr_context_, 0);
+        if (out_samples <= 0 || !reserve_audio_frame_buf(out_samples)) return false;
+        out_samples = swr_convert(swr_context_, &dest_audio_frame_buf_, out_samples, NULL, 0);
+        if (out_samples <= 0) return false;
+        int size = conver_audio_buffer_size(out_samples);
+        if (size <= 0 || !audio_fss_.append((int16_t *)dest_audio_frame_buf_, size)) return false;
+        frame_args fa;
+        fa.ft = Audio_Frame;
+        fa.position = audio_end_position_;
+        fa.duration = (double)out_samples/out_sample_rate_;
+        fa.size = size;
+        fa.audio_stream = &audio_fss_;
+        audio_end_position_ += fa.duration;
+        mark_decoded(fa);
+        pq.type = Audio_Frame;
+        pq.queue.push_back(fa);
+        return true;
+    }
+
+    bool drain_tempo(double rate, frame_queue& pq) {
+        unsigned int frame_size = 0;
+        int out_samples = 0;
+        if (!tempo_.flush([this, &frame_size, &out_samples](const uint8_t *data, int nb_samples){
+            int size = conver_audio_buffer_size(nb_samples);
+            if (size <= 0) return true;
+            if (!audio_fss_.append((int16_t *)data, size)) return false;
+            frame_size += size;
+            out_samples += nb_samples;
+            return true;
+        }) || !frame_size) return false;
+        frame_args fa;
+        fa.ft = Audio_Frame;
+        fa.position = audio_end_position_;
+        fa.duration = (double)out_samples*rate/out_sample_rate_;
+        fa.size = frame_size;
+        fa.audio_stream = &audio_fss_;
+        audio_end_position_ += fa.duration;
+        mark_decoded(fa);
+        pq.type = Audio_Frame;
+        pq.queue.push_back(fa);
+        return true;
+    }
+
     int conver_audio_buffer_size(const unsigned int out_samples) {
         return av_samples_get_buffer_size(NULL,
                                           out_channel_nb_,
@@ -640,7 +929,20 @@ private:
     }
 
     int16_t * get_audio_frame(unsigned int& frame_size) {
+        if (passthrough_) {
+            int size = conver_audio_buffer_size(original_frame_->nb_samples);
+            if (size < 0) {
+                handle_error();
+                return NULL;
+            }
+            frame_size = size;
+            return (int16_t *)original_frame_->data[0];
+        }
         int out_samples = audio_frame_convert();
+        if (out_samples == 0) {
+            frame_size = 0;
+            return (int16_t *)dest_audio_frame_buf_;
+        }
         if (out_samples > 0) {
             int out_buffer_size = conver_audio_buffer_size(out_samples);
             if (out_buffer_size < 0) {
@@ -655,30 +957,95 @@ private:
         return NULL;
     }
 
+    bool tempo_audio_frame(double rate, unsigned int& frame_size) {
+        if (!tempo_.is_open(rate, in_sample_fmt_, in_sample_rate_, in_ch_layout_) &&
+            !tempo_.open(rate,
+                         in_sample_fmt_,
+                         in_sample_rate_,
+                         in_ch_layout_,
+                         audio_codec_context_->channels,
+                         out_sample_fmt_,
+                         out_sample_rate_,
+                         out_ch_layout_)) {
+            handle_error();
+            return false;
+        }
+        frame_size = 0;
+        return tempo_.convert(original_frame_, [this, &frame_size](const uint8_t *data, int nb_samples){
+            int size = conver_audio_buffer_size(nb_samples);
+            if (size <= 0) return true;
+            if (!audio_fss_.append((int16_t *)data, size)) return false;
+            frame_size += size;
+            return true;
+        });
+    }
+
+    void trim_audio_frame(double seconds) {
+        int skip = std::min<int>(original_frame_->nb_samples,
+                                 (int)std::llround(seconds*audio_codec_context_->sample_rate));
+        if (skip <= 0) return;
+        enum AVSampleFormat sample_fmt = (enum AVSampleFormat)original_frame_->format;
+        int channels = audio_codec_context_->channels;
+        int planes = av_sample_fmt_is_planar(sample_fmt) ? channels : 1;
+        int offset = skip*av_get_bytes_per_sample(sample_fmt)*(av_sample_fmt_is_planar(sample_fmt) ? 1 : channels);
+        for (int i = 0; i < planes; i++) {
+            original_frame_->extended_data[i] += offset;
+            if (i < AV_NUM_DATA_POINTERS && original_frame_->extended_data != original_frame_->data)
+                original_frame_->data[i] += offset;
+        }
+        original_frame_->nb_samples -= skip;
+    }
+
     bool handle_audio_frame(frame_args& fa) {
         double frame_position = get_audio_frame_position();
         double frame_duration = get_audio_frame_duration();
+        if (audio_seek_target_ >= 0.0) {
+            if (frame_position+frame_duration <= audio_seek_target_) return true;
+            if (frame_position < audio_seek_target_) {
+                trim_audio_frame(audio_seek_target_-frame_position);
+                frame_duration -= audio_seek_target_-frame_position;
+                frame_position = audio_seek_target_;
+            }
+            audio_seek_target_ = -1.0;
+        }
         unsigned int frame_size = 0;
-        int16_t *pcm = get_audio_frame(frame_size);
-        if (frame_size > 0) {
-            if (!audio_fss_.append(pcm, frame_size)) {
+        double rate = rate_.load();
+        if (rate != 1.0) {
+            if (!tempo_audio_frame(rate, frame_size)) {
                 handle_error();
                 return false;
             }
+        } else {
+            int16_t *pcm = get_audio_frame(frame_size);
+            if (frame_size > 0) {
+                if (!audio_fss_.append(pcm, frame_size)) {
+                    handle_error();
+                    return false;
+                }
+            }
         }
+        audio_end_position_ = frame_position+frame_duration;
         fa.ft = Audio_Frame;
         fa.position = frame_position;
         fa.duration = frame_duration;
         fa.size = frame_size;
         fa.audio_stream = &audio_fss_;
+        mark_decoded(fa);
         return true;
     }
 
     Decode_Status decode_video_frame(frame_args& fa) {
-        int decode_len = avcodec_decode_video2(video_codec_context_,
+        enum AVDiscard skip_frame = rate_.load() >= 2.0 ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+        if (video_codec_context_->skip_frame != skip_frame) video_codec_context_->skip_frame = skip_frame;
+        int decode_len = 0;
+        {
+            ff_latency_histogram::scope scope(get_histogram(ff_pipeline_metrics::Decode_Stage));
+            ff_trace_scope trace("decode_video");
+            decode_len = avcodec_decode_video2(video_codec_context_,
                                                original_frame_,
                                                &frame_finished_,
                                                &packet_);
+        }
         if (decode_len > 0) {
             if (frame_finished_) {
                 if (!handle_video_frame(fa)) {
@@ -696,10 +1063,15 @@ private:
     }
 
     Decode_Status decode_audio_frame(frame_args& fa) {
-        int decode_len = avcodec_decode_audio4(audio_codec_context_,
+        int decode_len = 0;
+        {
+            ff_latency_histogram::scope scope(get_histogram(ff_pipeline_metrics::Decode_Stage));
+            ff_trace_scope trace("decode_audio");
+            decode_len = avcodec_decode_audio4(audio_codec_context_,
                                                original_frame_,
                                                &frame_finished_,
                                                &packet_);
+        }
         if (decode_len > 0) {
             if (frame_finished_) {
                 if (!handle_audio_frame(fa)) {
@@ -721,7 +1093,7 @@ private:
             frame_args fa;
             Decode_Status ds = decode_video_frame(fa);
             if (ds == Success) {
-                pq.push_back(fa);
+                if (fa.ft != Unknow_Frame) pq.push_back(fa);
             } else if (ds == No_More) {
                 break;
             } else {
@@ -738,7 +1110,7 @@ private:
             frame_args fa;
             Decode_Status ds = decode_audio_frame(fa);
             if (ds == Success) {
-                pq.push_back(fa);
+                if (fa.ft != Unknow_Frame) pq.push_back(fa);
             } else if (ds == No_More) {
                 break;
             } else {
@@ -760,14 +1132,15 @@ private:
 
 private:
     void print_av_info() {
-        av_dump_format(format_context_, 0, file_, 0);
+        if (ff_decode_default_dump_format)
+            av_dump_format(format_context_, 0, file_.c_str(), 0);
     }
 
 private:
     ff_decoder_base();
     ff_decoder_base(const ff_decoder_base&);
     ff_decoder_base& operator =(const ff_decoder_base&);
-    const char *file_;
+    std::string file_;
     AVFormatContext *format_context_ = NULL;
     int video_stream_ = -1;
     int audio_stream_ = -1;
@@ -787,7 +1160,16 @@ private:
     double audio_time_base_ = 0.0;
     double fps_ = 0.0;
     SwrContext *swr_context_ = NULL;
+    bool passthrough_ = false;
     int err_code_ = 0;
+    bool eof_ = false;
+    double video_seek_target_ = -1.0;
+    double audio_seek_target_ = -1.0;
+    double video_decimate_pos_ = -1.0;
+    std::atomic<double> rate_ {1.0};
+    ff_audio_tempo tempo_;
+    std::shared_ptr<ff_keyframe_index> keyframe_index_;
+    ff_pipeline_metrics *metrics_ = nullptr;
     double duration_ = 0.0;
     enum AVSampleFormat in_sample_fmt_ = AV_SAMPLE_FMT_NONE;
     enum AVSampleFormat out_sample_fmt_ = ff_decode_deafult_out_sample_format;
@@ -800,12 +1182,15 @@ private:
     unsigned int dest_width_ = 0;
     unsigned int dest_height_ = 0;
     uint8_t *dest_audio_frame_buf_;
+    unsigned int dest_audio_frame_buf_size_ = 0;
+    double audio_end_position_ = 0.0;
     int packet_size_ = 0;
 
     unsigned int audio_fss_diff_;
     unsigned int audio_fss_capacity_;
     unsigned int video_fss_diff_;
     unsigned int video_fss_capacity_;
+    size_t memory_budget_;
     ff_safe_stream<int16_t> audio_fss_;
     ff_safe_stream<uint8_t> video_fss_;
 };
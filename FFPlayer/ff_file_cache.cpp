@@ -0,0 +1,2 @@
+#include "ff_file_cache.h"
+
@@ -0,0 +1,147 @@
+#ifndef FF_FILE_CACHE_H
+#define FF_FILE_CACHE_H
+
+#include <assert.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <functional>
+#include <boost/filesystem.hpp>
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_file_identity {
+public:
+    ff_file_identity():
+        path_(),
+        size_(0),
+        mtime_(0) {}
+
+    bool load(const char *file) {
+        assert(file);
+        boost::system::error_code ec;
+        boost::filesystem::path p = boost::filesystem::canonical(file, ec);
+        if (ec) return false;
+        uintmax_t size = boost::filesystem::file_size(p, ec);
+        if (ec) return false;
+        std::time_t mtime = boost::filesystem::last_write_time(p, ec);
+        if (ec) return false;
+        path_ = p.string();
+        size_ = size;
+        mtime_ = mtime;
+        return true;
+    }
+
+    std::string key() const {
+        std::ostringstream oss;
+        oss << std::hex << std::setw(16) << std::setfill('0')
+            << std::hash<std::string>()(path_ + "|" + std::to_string(size_) + "|" + std::to_string(mtime_));
+        return oss.str();
+    }
+
+    bool write(std::ostream& os) const {
+        uint32_t path_len = path_.size();
+        os.write((const char *)&path_len, sizeof(path_len));
+        os.write(path_.data(), path_len);
+        os.write((const char *)&size_, sizeof(size_));
+        os.write((const char *)&mtime_, sizeof(mtime_));
+        return os.good();
+    }
+
+    bool read(std::istream& is) {
+        uint32_t path_len = 0;
+        is.read((char *)&path_len, sizeof(path_len));
+        if (!is.good() || path_len > 4096) return false;
+        path_.resize(path_len);
+        is.read(&path_[0], path_len);
+        is.read((char *)&size_, sizeof(size_));
+        is.read((char *)&mtime_, sizeof(mtime_));
+        return is.good();
+    }
+
+    bool operator==(const ff_file_identity& fi) const {
+        return path_ == fi.path_ && size_ == fi.size_ && mtime_ == fi.mtime_;
+    }
+
+    bool operator!=(const ff_file_identity& fi) const {
+        return !(*this == fi);
+    }
+
+    const std::string& get_path() const {return path_;}
+
+    uint64_t get_size() const {return size_;}
+
+    int64_t get_mtime() const {return mtime_;}
+
+private:
+    std::string path_;
+    uint64_t size_;
+    int64_t mtime_;
+};
+
+class ff_file_cache {
+public:
+    static std::string get_cache_file(const ff_file_identity& fi, const char *suffix) {
+        assert(suffix);
+        boost::system::error_code ec;
+        boost::filesystem::path dir(ff_file_cache_default_dir);
+        if (!boost::filesystem::exists(dir, ec)) {
+            boost::filesystem::create_directories(dir, ec);
+            if (ec) return std::string();
+        }
+        return (dir / (fi.key() + "." + suffix)).string();
+    }
+
+    static bool open_for_read(const ff_file_identity& fi,
+                              const char *suffix,
+                              uint32_t magic,
+                              std::ifstream& ifs) {
+        std::string cache_file = get_cache_file(fi, suffix);
+        if (cache_file.empty()) return false;
+        ifs.open(cache_file, std::ios::binary);
+        if (!ifs.is_open()) return false;
+        uint32_t m = 0;
+        ifs.read((char *)&m, sizeof(m));
+        ff_file_identity cached;
+        if (!ifs.good() || m != magic || !cached.read(ifs) || cached != fi) {
+            ifs.close();
+            return false;
+        }
+        return true;
+    }
+
+    static bool open_for_write(const ff_file_identity& fi,
+                               const char *suffix,
+                               uint32_t magic,
+                               std::ofstream& ofs,
+                               std::string& temp_file) {
+        std::string cache_file = get_cache_file(fi, suffix);
+        if (cache_file.empty()) return false;
+        temp_file = cache_file + "." + boost::filesystem::unique_path("%%%%%%%%").string() + ".tmp";
+        ofs.open(temp_file, std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open()) return false;
+        ofs.write((const char *)&magic, sizeof(magic));
+        return fi.write(ofs);
+    }
+
+    static bool close_for_write(const ff_file_identity& fi,
+                                const char *suffix,
+                                std::ofstream& ofs,
+                                const std::string& temp_file) {
+        bool good = ofs.good();
+        ofs.close();
+        good = good && !ofs.fail();
+        boost::system::error_code ec;
+        if (good) {
+            boost::filesystem::rename(temp_file, get_cache_file(fi, suffix), ec);
+            if (!ec) return true;
+        }
+        boost::filesystem::remove(temp_file, ec);
+        return false;
+    }
+};
+}
+
+#endif // FF_FILE_CACHE_H
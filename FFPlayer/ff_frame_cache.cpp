@@ -0,0 +1 @@
+#include "ff_frame_cache.h"
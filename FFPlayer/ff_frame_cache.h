@@ -0,0 +1,183 @@
+#ifndef FF_FRAME_CACHE_H
+#define FF_FRAME_CACHE_H
+
+#include <assert.h>
+#include <iostream>
+#include <mutex>
+#include <atomic>
+#include <list>
+#include <map>
+#include <vector>
+#include <memory>
+#include <cmath>
+
+namespace FFPlayer {
+class ff_frame_cache {
+public:
+    typedef std::shared_ptr<std::vector<uint8_t>> buffer;
+
+    class frame {
+    public:
+        double position = 0.0;
+        double duration = 0.0;
+        buffer data;
+    };
+
+    explicit ff_frame_cache(size_t max_bytes, size_t max_free = 8):
+        max_bytes_(max_bytes),
+        max_free_(max_free),
+        bytes_(0),
+        hits_(0),
+        misses_(0) {
+        assert(max_bytes_);
+    }
+
+    ~ff_frame_cache() {}
+
+    buffer acquire(size_t size) {
+        std::unique_lock<std::mutex> lock(m_);
+        while (!free_.empty()) {
+            buffer buf = free_.back();
+            free_.pop_back();
+            if (buf->size() == size) return buf;
+        }
+        return std::make_shared<std::vector<uint8_t>>(size);
+    }
+
+    void insert(double position, double duration, const buffer& data) {
+        assert(data);
+        std::unique_lock<std::mutex> lock(m_);
+        int64_t key = to_key(position);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            bytes_ -= it->second->data->size();
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+        frame f;
+        f.position = position;
+        f.duration = duration;
+        f.data = data;
+        lru_.push_front(f);
+        index_[key] = lru_.begin();
+        bytes_ += data->size();
+        while (bytes_ > max_bytes_ && lru_.size() > 1) evict();
+    }
+
+    bool find(double position, frame& f) {
+        std::unique_lock<std::mutex> lock(m_);
+        auto it = index_.upper_bound(to_key(position));
+        if (it != index_.begin()) {
+            --it;
+            const frame& cached = *it->second;
+            if (position < cached.position+std::max(cached.duration, 0.001)) {
+                touch(it->second);
+                f = *it->second;
+                hits_.fetch_add(1);
+                return true;
+            }
+        }
+        misses_.fetch_add(1);
+        return false;
+    }
+
+    bool find_before(double position, frame& f) {
+        std::unique_lock<std::mutex> lock(m_);
+        auto it = index_.lower_bound(to_key(position));
+        if (it == index_.begin()) {
+            misses_.fetch_add(1);
+            return false;
+        }
+        --it;
+        const frame& cached = *it->second;
+        if (position-cached.position > std::max(cached.duration, 0.001)*1.5) {
+            misses_.fetch_add(1);
+            return false;
+        }
+        touch(it->second);
+        f = *it->second;
+        hits_.fetch_add(1);
+        return true;
+    }
+
+    bool find_after(double position, frame& f) {
+        std::unique_lock<std::mutex> lock(m_);
+        auto it = index_.upper_bound(to_key(position));
+        if (it == index_.end()) {
+            misses_.fetch_add(1);
+            return false;
+        }
+        const frame& cached = *it->second;
+        if (cached.position-position > std::max(cached.duration, 0.001)*1.5) {
+            misses_.fetch_add(1);
+            return false;
+        }
+        touch(it->second);
+        f = *it->second;
+        hits_.fetch_add(1);
+        return true;
+    }
+
+    void clear() {
+        std::unique_lock<std::mutex> lock(m_);
+        lru_.clear();
+        index_.clear();
+        bytes_ = 0;
+    }
+
+    size_t get_bytes() {
+        std::unique_lock<std::mutex> lock(m_);
+        return bytes_;
+    }
+
+    size_t get_max_bytes() const {
+        return max_bytes_;
+    }
+
+    size_t size() {
+        std::unique_lock<std::mutex> lock(m_);
+        return lru_.size();
+    }
+
+    unsigned long long get_hits() const {
+        return hits_.load();
+    }
+
+    unsigned long long get_misses() const {
+        return misses_.load();
+    }
+
+private:
+    static int64_t to_key(double position) {
+        return (int64_t)std::llround(position*1000000.0);
+    }
+
+    void touch(std::list<frame>::iterator it) {
+        lru_.splice(lru_.begin(), lru_, it);
+    }
+
+    void evict() {
+        frame& f = lru_.back();
+        bytes_ -= f.data->size();
+        index_.erase(to_key(f.position));
+        if (f.data.use_count() == 1 && free_.size() < max_free_) free_.push_back(f.data);
+        lru_.pop_back();
+    }
+
+private:
+    ff_frame_cache();
+    ff_frame_cache(const ff_frame_cache&);
+    ff_frame_cache& operator =(const ff_frame_cache&);
+    std::mutex m_;
+    size_t max_bytes_;
+    size_t max_free_;
+    size_t bytes_;
+    std::list<frame> lru_;
+    std::map<int64_t, std::list<frame>::iterator> index_;
+    std::vector<buffer> free_;
+    std::atomic_ullong hits_;
+    std::atomic_ullong misses_;
+};
+}
+
+#endif // FF_FRAME_CACHE_H
@@ -0,0 +1 @@
+#include "ff_gop_cache.h"
@@ -0,0 +1,69 @@
+#ifndef FF_GOP_CACHE_H
+#define FF_GOP_CACHE_H
+
+#include <assert.h>
+#include <iostream>
+#include <string>
+#include <mutex>
+#include <memory>
+#include "ff_keyframe_decoder.h"
+#include "ff_frame_cache.h"
+
+namespace FFPlayer {
+class ff_gop_cache {
+public:
+    ff_gop_cache(const unsigned int dest_width,
+                 const unsigned int dest_height,
+                 const size_t max_bytes):
+        decoder_(dest_width, dest_height, AV_PIX_FMT_RGB24, false),
+        frames_(max_bytes) {}
+
+    ~ff_gop_cache() {}
+
+    bool step(const char *file, double pos, bool forward, ff_frame_cache::frame& f) {
+        assert(file);
+        std::unique_lock<std::mutex> lock(m_);
+        if (!decoder_.is_open() || decoder_.get_file() != file) {
+            frames_.clear();
+            if (!decoder_.open(file)) return false;
+        }
+        if (find(pos, forward, f)) return true;
+        double frame_duration = decoder_.get_frame_duration();
+        double target = forward ? pos+frame_duration*1.5 : pos-frame_duration*0.5;
+        if (target < 0.0) target = 0.0;
+        if (!decoder_.decode_gop(target, [this](double frame_pos,
+                                                double frame_duration,
+                                                std::vector<uint8_t>& picture){
+            ff_frame_cache::buffer data = std::make_shared<std::vector<uint8_t>>();
+            data->swap(picture);
+            frames_.insert(frame_pos, frame_duration, data);
+        })) return false;
+        return find(pos, forward, f);
+    }
+
+    void clear() {
+        std::unique_lock<std::mutex> lock(m_);
+        frames_.clear();
+        decoder_.close();
+    }
+
+    ff_frame_cache& get_frames() {
+        return frames_;
+    }
+
+private:
+    bool find(double pos, bool forward, ff_frame_cache::frame& f) {
+        return forward ? frames_.find_after(pos, f) : frames_.find_before(pos, f);
+    }
+
+private:
+    ff_gop_cache();
+    ff_gop_cache(const ff_gop_cache&);
+    ff_gop_cache& operator =(const ff_gop_cache&);
+    std::mutex m_;
+    ff_keyframe_decoder decoder_;
+    ff_frame_cache frames_;
+};
+}
+
+#endif // FF_GOP_CACHE_H
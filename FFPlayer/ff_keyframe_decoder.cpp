@@ -0,0 +1,2 @@
+#include "ff_keyframe_decoder.h"
+
@@ -0,0 +1,273 @@
+#ifndef FF_KEYFRAME_DECODER_H
+#define FF_KEYFRAME_DECODER_H
+
+#include <assert.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_keyframe_decoder {
+public:
+    ff_keyframe_decoder(const unsigned int dest_width,
+                        const unsigned int dest_height,
+                        const AVPixelFormat dest_vft = AV_PIX_FMT_RGB24,
+                        const bool keyframes_only = true):
+        dest_width_(dest_width),
+        dest_height_(dest_height),
+        dest_vft_(dest_vft),
+        keyframes_only_(keyframes_only) {
+        assert(dest_width_);
+        assert(dest_height_);
+    }
+
+    ~ff_keyframe_decoder() {close();}
+
+    bool open(const char *file) {
+        assert(file);
+        close();
+        ff_register_all();
+        format_context_ = avformat_alloc_context();
+        AVDictionary *format_opts = NULL;
+        av_dict_set_int(&format_opts, "probesize", ff_decode_default_probe_size, 0);
+        av_dict_set_int(&format_opts, "analyzeduration", ff_decode_default_analyze_duration, 0);
+        err_code_ = avformat_open_input(&format_context_, file, NULL, &format_opts);
+        av_dict_free(&format_opts);
+        if (err_code_) {
+            close();
+            return false;
+        }
+        video_stream_ = av_find_best_stream(format_context_, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+        if (video_stream_ < 0) {
+            close();
+            return false;
+        }
+        for (unsigned int i = 0; i < format_context_->nb_streams; i++) {
+            if ((int)i != video_stream_) format_context_->streams[i]->discard = AVDISCARD_ALL;
+        }
+        AVStream *st = format_context_->streams[video_stream_];
+        st->discard = keyframes_only_ ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+        AVCodec *codec = avcodec_find_decoder(st->codec->codec_id);
+        if (!codec) {
+            close();
+            return false;
+        }
+        codec_context_ = avcodec_alloc_context3(codec);
+        if (!codec_context_ || avcodec_copy_context(codec_context_, st->codec) < 0) {
+            close();
+            return false;
+        }
+        if (keyframes_only_) {
+            codec_context_->thread_count = 1;
+            codec_context_->skip_frame = AVDISCARD_NONKEY;
+            codec_context_->skip_loop_filter = AVDISCARD_ALL;
+        }
+        err_code_ = avcodec_open2(codec_context_, codec, NULL);
+        if (err_code_ < 0) {
+            close();
+            return false;
+        }
+        frame_ = av_frame_alloc();
+        if (!frame_) {
+            close();
+            return false;
+        }
+        time_base_ = av_q2d(st->time_base);
+        if (st->avg_frame_rate.num && st->avg_frame_rate.den) frame_duration_ = 1.0/av_q2d(st->avg_frame_rate);
+        else frame_duration_ = 0.04;
+        if (format_context_->duration == AV_NOPTS_VALUE) duration_ = 0.0;
+        else duration_ = (double)format_context_->duration/(double)AV_TIME_BASE;
+        file_ = file;
+        return true;
+    }
+
+    void close() {
+        if (sws_context_) {
+            sws_freeContext(sws_context_);
+            sws_context_ = NULL;
+        }
+        if (frame_) av_frame_free(&frame_);
+        if (codec_context_) avcodec_free_context(&codec_context_);
+        if (format_context_) avformat_close_input(&format_context_);
+        frame_ = NULL;
+        codec_context_ = NULL;
+        format_context_ = NULL;
+        video_stream_ = -1;
+        duration_ = 0.0;
+        file_.clear();
+    }
+
+    bool is_open() const {
+        return format_context_ != NULL;
+    }
+
+    const std::string& get_file() const {
+        return file_;
+    }
+
+    double get_duration() const {
+        return duration_;
+    }
+
+    double get_frame_duration() const {
+        return frame_duration_;
+    }
+
+    unsigned int get_dest_width() const {
+        return dest_width_;
+    }
+
+    unsigned int get_dest_height() const {
+        return dest_height_;
+    }
+
+    unsigned int get_picture_size() const {
+        return avpicture_get_size(dest_vft_, dest_width_, dest_height_);
+    }
+
+    bool decode_at(const double pos,
+                   std::vector<uint8_t>& picture,
+                   double& frame_pos,
+                   std::function<bool()> canceled = nullptr) {
+        if (!is_open()) return false;
+        int64_t ts = (int64_t)(pos/time_base_);
+        if (av_seek_frame(format_context_, video_stream_, ts, AVSEEK_FLAG_BACKWARD) < 0) return false;
+        avcodec_flush_buffers(codec_context_);
+        AVPacket packet;
+        av_init_packet(&packet);
+        int got_frame = 0;
+        while (!got_frame) {
+            if (canceled && canceled()) return false;
+            if (av_read_frame(format_context_, &packet) < 0) break;
+            if (packet.stream_index == video_stream_ && (packet.flags & AV_PKT_FLAG_KEY)) {
+                if (avcodec_decode_video2(codec_context_, frame_, &got_frame, &packet) < 0) {
+                    av_free_packet(&packet);
+                    return false;
+                }
+            }
+            av_free_packet(&packet);
+        }
+        if (!got_frame) {
+            packet.data = NULL;
+            packet.size = 0;
+            if (avcodec_decode_video2(codec_context_, frame_, &got_frame, &packet) < 0 || !got_frame)
+                return false;
+        }
+        if (canceled && canceled()) return false;
+        frame_pos = av_frame_get_best_effort_timestamp(frame_)*time_base_;
+        return scale(picture);
+    }
+
+    bool decode_gop(const double pos,
+                    std::function<void(double, double, std::vector<uint8_t>&)> frame_cb,
+                    std::function<bool()> canceled = nullptr) {
+        assert(frame_cb);
+        if (!is_open() || keyframes_only_) return false;
+        int64_t ts = (int64_t)(pos/time_base_);
+        if (av_seek_frame(format_context_, video_stream_, ts, AVSEEK_FLAG_BACKWARD) < 0) return false;
+        avcodec_flush_buffers(codec_context_);
+        AVPacket packet;
+        av_init_packet(&packet);
+        std::vector<uint8_t> picture;
+        unsigned int nb_frames = 0;
+        int got_frame = 0;
+        while (true) {
+            if (canceled && canceled()) return false;
+            if (av_read_frame(format_context_, &packet) < 0) break;
+            if (packet.stream_index != video_stream_) {
+                av_free_packet(&packet);
+                continue;
+            }
+            if ((packet.flags & AV_PKT_FLAG_KEY) && nb_frames) {
+                int64_t packet_ts = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+                if (packet_ts != AV_NOPTS_VALUE && packet_ts*time_base_ > pos) {
+                    av_free_packet(&packet);
+                    break;
+                }
+            }
+            int ret = avcodec_decode_video2(codec_context_, frame_, &got_frame, &packet);
+            av_free_packet(&packet);
+            if (ret < 0) return false;
+            if (got_frame) {
+                nb_frames++;
+                if (!emit_frame(picture, frame_cb)) return false;
+            }
+        }
+        packet.data = NULL;
+        packet.size = 0;
+        do {
+            if (avcodec_decode_video2(codec_context_, frame_, &got_frame, &packet) < 0) break;
+            if (got_frame) {
+                nb_frames++;
+                if (!emit_frame(picture, frame_cb)) return false;
+            }
+        } while (got_frame);
+        avcodec_flush_buffers(codec_context_);
+        return nb_frames > 0;
+    }
+
+private:
+    bool emit_frame(std::vector<uint8_t>& picture,
+                    std::function<void(double, double, std::vector<uint8_t>&)>& frame_cb) {
+        double frame_pos = av_frame_get_best_effort_timestamp(frame_)*time_base_;
+        double frame_duration = av_frame_get_pkt_duration(frame_)*time_base_;
+        if (frame_duration <= 0.0) frame_duration = frame_duration_;
+        if (!scale(picture)) return false;
+        frame_cb(frame_pos, frame_duration, picture);
+        return true;
+    }
+
+    bool scale(std::vector<uint8_t>& picture) {
+        sws_context_ = sws_getCachedContext(sws_context_,
+                                            frame_->width,
+                                            frame_->height,
+                                            (enum AVPixelFormat)frame_->format,
+                                            dest_width_,
+                                            dest_height_,
+                                            dest_vft_,
+                                            SWS_FAST_BILINEAR,
+                                            NULL,
+                                            NULL,
+                                            NULL);
+        if (!sws_context_) return false;
+        picture.resize(get_picture_size());
+        AVPicture dest;
+        avpicture_fill(&dest, picture.data(), dest_vft_, dest_width_, dest_height_);
+        return sws_scale(sws_context_,
+                         (const uint8_t* const*)frame_->data,
+                         frame_->linesize,
+                         0,
+                         frame_->height,
+                         dest.data,
+                         dest.linesize) == (int)dest_height_;
+    }
+
+private:
+    ff_keyframe_decoder();
+    ff_keyframe_decoder(const ff_keyframe_decoder&);
+    ff_keyframe_decoder& operator =(const ff_keyframe_decoder&);
+    unsigned int dest_width_;
+    unsigned int dest_height_;
+    AVPixelFormat dest_vft_;
+    bool keyframes_only_;
+    std::string file_;
+    AVFormatContext *format_context_ = NULL;
+    AVCodecContext *codec_context_ = NULL;
+    AVFrame *frame_ = NULL;
+    struct SwsContext *sws_context_ = NULL;
+    int video_stream_ = -1;
+    double time_base_ = 0.0;
+    double duration_ = 0.0;
+    double frame_duration_ = 0.04;
+    int err_code_ = 0;
+};
+}
+
+#endif // FF_KEYFRAME_DECODER_H
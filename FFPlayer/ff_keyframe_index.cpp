@@ -0,0 +1,7 @@
+#include "ff_keyframe_index.h"
+
+namespace FFPlayer {
+constexpr const char *ff_keyframe_index::suffix_;
+constexpr uint32_t ff_keyframe_index::magic_;
+ff_keyframe_index::builder ff_keyframe_index::builder_;
+}
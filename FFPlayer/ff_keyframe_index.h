@@ -0,0 +1,244 @@
+#ifndef FF_KEYFRAME_INDEX_H
+#define FF_KEYFRAME_INDEX_H
+
+#include <assert.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <functional>
+#include <memory>
+#include <algorithm>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+#include "ff_file_cache.h"
+#include "mp4_helper.h"
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_keyframe_index {
+public:
+    class entry {
+    public:
+        double position = 0.0;
+        int64_t offset = -1;
+    };
+
+    explicit ff_keyframe_index(const char *file):
+        file_(file),
+        ready_(false) {
+        assert(file);
+    }
+
+    ~ff_keyframe_index() {}
+
+    static std::shared_ptr<ff_keyframe_index> asyn_build(const char *file) {
+        return builder_.submit(file);
+    }
+
+    bool build(std::function<bool()> canceled = nullptr) {
+        if (load()) {
+            ready_.store(true);
+            return true;
+        }
+        if (build_from_mp4() || build_by_scanning(canceled)) {
+            ready_.store(true);
+            store();
+            return true;
+        }
+        return false;
+    }
+
+    bool find(double position, entry& e) {
+        if (!ready_.load()) return false;
+        std::unique_lock<std::mutex> lock(m_);
+        auto it = std::upper_bound(entries_.begin(),
+                                   entries_.end(),
+                                   position,
+                                   [](double pos, const entry& e){
+            return pos < e.position;
+        });
+        if (it == entries_.begin()) return false;
+        e = *(--it);
+        return true;
+    }
+
+    bool is_ready() {
+        return ready_.load();
+    }
+
+    size_t size() {
+        std::unique_lock<std::mutex> lock(m_);
+        return entries_.size();
+    }
+
+private:
+    bool load() {
+        if (!fi_.load(file_.c_str())) return false;
+        std::ifstream ifs;
+        if (!ff_file_cache::open_for_read(fi_, suffix_, magic_, ifs)) return false;
+        uint32_t nb_entries = 0;
+        ifs.read((char *)&nb_entries, sizeof(nb_entries));
+        if (!ifs.good() || !nb_entries) return false;
+        std::vector<entry> entries(nb_entries);
+        ifs.read((char *)entries.data(), nb_entries*sizeof(entry));
+        if (!ifs.good()) return false;
+        std::unique_lock<std::mutex> lock(m_);
+        entries_.swap(entries);
+        return true;
+    }
+
+    bool store() {
+        if (!fi_.load(file_.c_str())) return false;
+        std::ofstream ofs;
+        std::string temp_file;
+        if (!ff_file_cache::open_for_write(fi_, suffix_, magic_, ofs, temp_file)) return false;
+        std::unique_lock<std::mutex> lock(m_);
+        uint32_t nb_entries = entries_.size();
+        ofs.write((const char *)&nb_entries, sizeof(nb_entries));
+        ofs.write((const char *)entries_.data(), nb_entries*sizeof(entry));
+        return ff_file_cache::close_for_write(fi_, suffix_, ofs, temp_file);
+    }
+
+    bool build_from_mp4() {
+        mp4_helper mh(file_.c_str());
+        std::vector<std::pair<double, uint64_t>> samples;
+        if (!mh.get_video_sync_samples(samples)) return false;
+        std::vector<entry> entries;
+        entries.reserve(samples.size());
+        for (auto& sample: samples) {
+            entry e;
+            e.position = sample.first;
+            e.offset = sample.second;
+            entries.push_back(e);
+        }
+        set_entries(entries);
+        return true;
+    }
+
+    bool build_by_scanning(std::function<bool()> canceled) {
+        ff_register_all();
+        AVFormatContext *format_context = avformat_alloc_context();
+        if (avformat_open_input(&format_context, file_.c_str(), NULL, NULL)) return false;
+        int video_stream = av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+        if (video_stream < 0) {
+            avformat_close_input(&format_context);
+            return false;
+        }
+        for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+            if ((int)i != video_stream) format_context->streams[i]->discard = AVDISCARD_ALL;
+        }
+        double time_base = av_q2d(format_context->streams[video_stream]->time_base);
+        std::vector<entry> entries;
+        AVPacket packet;
+        av_init_packet(&packet);
+        while (!(canceled && canceled()) && av_read_frame(format_context, &packet) >= 0) {
+            if (packet.stream_index == video_stream && (packet.flags & AV_PKT_FLAG_KEY)) {
+                int64_t ts = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+                if (ts != AV_NOPTS_VALUE) {
+                    entry e;
+                    e.position = ts*time_base;
+                    e.offset = packet.pos;
+                    entries.push_back(e);
+                }
+            }
+            av_free_packet(&packet);
+        }
+        avformat_close_input(&format_context);
+        if ((canceled && canceled()) || entries.empty()) return false;
+        set_entries(entries);
+        return true;
+    }
+
+    void set_entries(std::vector<entry>& entries) {
+        std::sort(entries.begin(), entries.end(), [](const entry& e1, const entry& e2){
+            return e1.position < e2.position;
+        });
+        std::unique_lock<std::mutex> lock(m_);
+        entries_.swap(entries);
+    }
+
+private:
+    class builder {
+    public:
+        builder():
+            stopping_(false) {}
+
+        ~builder() {
+            {
+                std::unique_lock<std::mutex> lock(m_);
+                stopping_ = true;
+                jobs_.clear();
+                cv_.notify_all();
+            }
+            if (thr_.joinable()) thr_.join();
+        }
+
+        std::shared_ptr<ff_keyframe_index> submit(const char *file) {
+            std::unique_lock<std::mutex> lock(m_);
+            for (auto it = indexes_.begin(); it != indexes_.end();) {
+                if (it->second.expired()) it = indexes_.erase(it);
+                else ++it;
+            }
+            std::shared_ptr<ff_keyframe_index> index = indexes_[file].lock();
+            if (index) return index;
+            index = std::make_shared<ff_keyframe_index>(file);
+            indexes_[file] = index;
+            if (stopping_) return index;
+            jobs_.push_back(index);
+            if (!thr_.joinable()) {
+                std::thread t([this](){run();});
+                thr_.swap(t);
+            }
+            cv_.notify_all();
+            return index;
+        }
+
+    private:
+        void run() {
+            ff_lower_thread_priority();
+            std::unique_lock<std::mutex> lock(m_);
+            while (true) {
+                cv_.wait(lock, [this](){return stopping_ || !jobs_.empty();});
+                if (stopping_) return;
+                std::shared_ptr<ff_keyframe_index> index = jobs_.front();
+                jobs_.pop_front();
+                if (index.use_count() == 1) continue;
+                lock.unlock();
+                index->build([this, &index](){return stopping_ || index.use_count() == 1;});
+                index.reset();
+                lock.lock();
+            }
+        }
+
+    private:
+        std::mutex m_;
+        std::condition_variable cv_;
+        std::deque<std::shared_ptr<ff_keyframe_index>> jobs_;
+        std::map<std::string, std::weak_ptr<ff_keyframe_index>> indexes_;
+        std::atomic_bool stopping_;
+        std::thread thr_;
+    };
+
+    ff_keyframe_index();
+    ff_keyframe_index(const ff_keyframe_index&);
+    ff_keyframe_index& operator =(const ff_keyframe_index&);
+    static constexpr const char *suffix_ = "kfidx";
+    static constexpr uint32_t magic_ = 0x46464b49;
+    static builder builder_;
+    std::string file_;
+    ff_file_identity fi_;
+    std::mutex m_;
+    std::vector<entry> entries_;
+    std::atomic_bool ready_;
+};
+}
+
+#endif // FF_KEYFRAME_INDEX_H
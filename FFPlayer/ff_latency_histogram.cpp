@@ -0,0 +1,9 @@
+#include "ff_latency_histogram.h"
+
+namespace FFPlayer {
+constexpr unsigned int ff_latency_histogram::sub_bucket_bits;
+constexpr unsigned int ff_latency_histogram::sub_bucket_nb;
+constexpr unsigned int ff_latency_histogram::max_value_bits;
+constexpr unsigned int ff_latency_histogram::bucket_nb;
+constexpr unsigned long long ff_latency_histogram::max_value;
+}
@@ -0,0 +1,142 @@
+#ifndef FF_LATENCY_HISTOGRAM_H
+#define FF_LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+namespace FFPlayer {
+class ff_latency_summary {
+public:
+    unsigned long long count = 0;
+    unsigned long long min = 0;
+    unsigned long long max = 0;
+    double mean = 0.0;
+    unsigned long long p50 = 0;
+    unsigned long long p90 = 0;
+    unsigned long long p99 = 0;
+    unsigned long long p999 = 0;
+};
+
+class ff_latency_histogram {
+public:
+    static constexpr unsigned int sub_bucket_bits = 5;
+    static constexpr unsigned int sub_bucket_nb = 1u << sub_bucket_bits;
+    static constexpr unsigned int max_value_bits = 36;
+    static constexpr unsigned int bucket_nb = (max_value_bits-sub_bucket_bits+1)*sub_bucket_nb;
+    static constexpr unsigned long long max_value = (1ull << max_value_bits)-1;
+
+    ff_latency_histogram() {
+        reset();
+    }
+
+    void record(unsigned long long us) {
+        us = std::min(us, max_value);
+        buckets_[index_of(us)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(us, std::memory_order_relaxed);
+        unsigned long long max = max_.load(std::memory_order_relaxed);
+        while (us > max && !max_.compare_exchange_weak(max, us, std::memory_order_relaxed));
+        unsigned long long min = min_.load(std::memory_order_relaxed);
+        while (us < min && !min_.compare_exchange_weak(min, us, std::memory_order_relaxed));
+    }
+
+    void reset() {
+        for (unsigned int i = 0; i < bucket_nb; i++) buckets_[i].store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+        min_.store(max_value, std::memory_order_relaxed);
+    }
+
+    ff_latency_summary summarize() const {
+        ff_latency_summary summary;
+        unsigned long long counts[bucket_nb];
+        unsigned long long total = 0;
+        for (unsigned int i = 0; i < bucket_nb; i++) {
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (!total) return summary;
+        summary.count = total;
+        summary.min = min_.load(std::memory_order_relaxed);
+        summary.max = max_.load(std::memory_order_relaxed);
+        summary.mean = (double)sum_.load(std::memory_order_relaxed)/total;
+        summary.p50 = percentile(counts, total, 0.5, summary.max);
+        summary.p90 = percentile(counts, total, 0.9, summary.max);
+        summary.p99 = percentile(counts, total, 0.99, summary.max);
+        summary.p999 = percentile(counts, total, 0.999, summary.max);
+        return summary;
+    }
+
+    static unsigned int index_of(unsigned long long v) {
+        if (v < sub_bucket_nb) return (unsigned int)v;
+        unsigned int msb = 63-count_leading_zeros(v);
+        unsigned int group = msb-sub_bucket_bits+1;
+        unsigned int sub = (unsigned int)(v >> (group-1))-sub_bucket_nb;
+        return group*sub_bucket_nb+sub;
+    }
+
+    static unsigned long long highest_of(unsigned int index) {
+        if (index < sub_bucket_nb) return index;
+        unsigned int group = index >> sub_bucket_bits;
+        unsigned long long sub = index&(sub_bucket_nb-1);
+        return ((sub_bucket_nb+sub+1) << (group-1))-1;
+    }
+
+    class scope {
+    public:
+        explicit scope(ff_latency_histogram *histogram):
+            histogram_(histogram),
+            start_(histogram ? now() : 0) {}
+
+        ~scope() {
+            if (histogram_) histogram_->record(now()-start_);
+        }
+
+    private:
+        scope(const scope&);
+        scope& operator =(const scope&);
+        ff_latency_histogram *histogram_;
+        unsigned long long start_;
+    };
+
+    static unsigned long long now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>\
+                (std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static unsigned int count_leading_zeros(unsigned long long v) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(v);
+#else
+        unsigned int n = 0;
+        for (unsigned long long bit = 1ull << 63; !(v&bit); bit >>= 1) n++;
+        return n;
+#endif
+    }
+
+    static unsigned long long percentile(const unsigned long long *counts,
+                                         unsigned long long total,
+                                         double q,
+                                         unsigned long long max) {
+        unsigned long long rank = std::max<unsigned long long>(1, (unsigned long long)(q*total+0.5));
+        unsigned long long seen = 0;
+        for (unsigned int i = 0; i < bucket_nb; i++) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(highest_of(i), max);
+        }
+        return max;
+    }
+
+private:
+    ff_latency_histogram(const ff_latency_histogram&);
+    ff_latency_histogram& operator =(const ff_latency_histogram&);
+    std::atomic_ullong buckets_[bucket_nb];
+    std::atomic_ullong sum_;
+    std::atomic_ullong max_;
+    std::atomic_ullong min_;
+};
+}
+
+#endif // FF_LATENCY_HISTOGRAM_H
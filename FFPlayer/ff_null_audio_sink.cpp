@@ -0,0 +1 @@
+#include "ff_null_audio_sink.h"
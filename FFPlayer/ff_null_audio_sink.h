@@ -0,0 +1,139 @@
+#ifndef FF_NULL_AUDIO_SINK_H
+#define FF_NULL_AUDIO_SINK_H
+
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <limits>
+#include "ff_pcm_ring.h"
+#include "ff_audio_sink.h"
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_null_audio_sink: public ff_audio_sink {
+public:
+    explicit ff_null_audio_sink(bool realtime = true):
+        realtime_(realtime),
+        consumed_bytes_(0),
+        underruns_(0),
+        overruns_(0),
+        started_(false) {}
+
+    ~ff_null_audio_sink() {
+        stop();
+    }
+
+    virtual bool prepare() override {
+        std::unique_lock<std::mutex> lock(m_);
+        frame_bytes_ = get_frame_bytes();
+        if (!frame_bytes_ || sample_rate_ <= 0.0) return false;
+        if (realtime_ && !ring_) ring_.reset(new ff_pcm_ring(sample_rate_*ring_seconds_*frame_bytes_));
+        return true;
+    }
+
+    virtual bool start() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (started_.load()) return true;
+        if (!frame_bytes_) return false;
+        started_.store(true);
+        if (!realtime_) return true;
+        std::thread t([this](){
+            unsigned long frames = frames_per_buffer_ ? frames_per_buffer_ : ff_audio_deafult_output_frames_per_buffer_nb;
+            std::vector<uint8_t> period(frames*frame_bytes_);
+            std::chrono::microseconds interval((long long)(frames*1000000.0/sample_rate_));
+            std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+            bool starved = true;
+            while (started_.load()) {
+                next += interval;
+                std::this_thread::sleep_until(next);
+                size_t nb = ring_->read(period.data(), period.size());
+                consumed_bytes_.fetch_add(nb);
+                if (nb < period.size() && (nb || !starved)) underruns_.fetch_add(1);
+                starved = nb < period.size();
+            }
+        });
+        thr_.swap(t);
+        return true;
+    }
+
+    virtual bool is_started() const override {
+        return started_.load();
+    }
+
+    virtual bool stop() override {
+        std::unique_lock<std::mutex> lock(m_);
+        started_.store(false);
+        if (thr_.joinable()) thr_.join();
+        return true;
+    }
+
+    virtual bool close() override {
+        return true;
+    }
+
+    virtual bool write(const void *data, size_t size) override {
+        if (!realtime_) {
+            consumed_bytes_.fetch_add(size);
+            return true;
+        }
+        if (!ring_) return false;
+        if (ring_->write(data, size)) return true;
+        overruns_.fetch_add(1);
+        return false;
+    }
+
+    virtual void flush() override {
+        if (ring_) ring_->flush();
+    }
+
+    virtual size_t write_available() const override {
+        if (!realtime_) return std::numeric_limits<size_t>::max();
+        return ring_ ? ring_->write_available() : 0;
+    }
+
+    virtual double get_buffered_seconds() const override {
+        if (!ring_ || !frame_bytes_) return 0.0;
+        return ring_->read_available()/(double)frame_bytes_/sample_rate_;
+    }
+
+    virtual unsigned long long get_underruns() const override {
+        return underruns_.load();
+    }
+
+    virtual unsigned long long get_overruns() const override {
+        return overruns_.load();
+    }
+
+    unsigned long long get_consumed_bytes() const {
+        return consumed_bytes_.load();
+    }
+
+    double get_consumed_seconds() const {
+        if (!frame_bytes_) return 0.0;
+        return consumed_bytes_.load()/(double)frame_bytes_/sample_rate_;
+    }
+
+    bool is_realtime() const {
+        return realtime_;
+    }
+
+private:
+    ff_null_audio_sink(const ff_null_audio_sink&);
+    ff_null_audio_sink& operator =(const ff_null_audio_sink&);
+    std::mutex m_;
+    bool realtime_;
+    size_t frame_bytes_ = 0;
+    std::unique_ptr<ff_pcm_ring> ring_;
+    std::atomic_ullong consumed_bytes_;
+    std::atomic_ullong underruns_;
+    std::atomic_ullong overruns_;
+    std::atomic_bool started_;
+    std::thread thr_;
+};
+}
+
+#endif // FF_NULL_AUDIO_SINK_H
@@ -0,0 +1 @@
+#include "ff_pcm_ring.h"
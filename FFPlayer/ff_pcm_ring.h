@@ -0,0 +1,95 @@
+#ifndef FF_PCM_RING_H
+#define FF_PCM_RING_H
+
+#include <assert.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+namespace FFPlayer {
+class ff_pcm_ring {
+public:
+    explicit ff_pcm_ring(size_t capacity):
+        capacity_(round_up(capacity)),
+        mask_(capacity_-1),
+        buffer_(new uint8_t[capacity_]),
+        read_(0),
+        write_(0),
+        flush_to_(0) {
+        assert(capacity);
+    }
+
+    ~ff_pcm_ring() {}
+
+    bool write(const void *data, size_t size) {
+        size_t w = write_.load(std::memory_order_relaxed);
+        size_t r = read_.load(std::memory_order_acquire);
+        if (capacity_-(w-r) < size) return false;
+        copy_in(w, (const uint8_t *)data, size);
+        write_.store(w+size, std::memory_order_release);
+        return true;
+    }
+
+    size_t read(void *data, size_t size) {
+        size_t r = read_.load(std::memory_order_relaxed);
+        size_t flush_to = flush_to_.load(std::memory_order_acquire);
+        if (flush_to-r <= capacity_ && flush_to != r) r = flush_to;
+        size_t w = write_.load(std::memory_order_acquire);
+        size_t nb = std::min(size, w-r);
+        copy_out(r, (uint8_t *)data, nb);
+        read_.store(r+nb, std::memory_order_release);
+        return nb;
+    }
+
+    void flush() {
+        flush_to_.store(write_.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+
+    size_t write_available() const {
+        return capacity_-read_available();
+    }
+
+    size_t read_available() const {
+        return write_.load(std::memory_order_acquire)-read_.load(std::memory_order_acquire);
+    }
+
+    size_t get_capacity() const {
+        return capacity_;
+    }
+
+private:
+    static size_t round_up(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        return size;
+    }
+
+    void copy_in(size_t pos, const uint8_t *data, size_t size) {
+        size_t offset = pos&mask_;
+        size_t first = std::min(size, capacity_-offset);
+        memcpy(buffer_.get()+offset, data, first);
+        memcpy(buffer_.get(), data+first, size-first);
+    }
+
+    void copy_out(size_t pos, uint8_t *data, size_t size) {
+        size_t offset = pos&mask_;
+        size_t first = std::min(size, capacity_-offset);
+        memcpy(data, buffer_.get()+offset, first);
+        memcpy(data+first, buffer_.get(), size-first);
+    }
+
+private:
+    ff_pcm_ring();
+    ff_pcm_ring(const ff_pcm_ring&);
+    ff_pcm_ring& operator =(const ff_pcm_ring&);
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<uint8_t[]> buffer_;
+    std::atomic<size_t> read_;
+    std::atomic<size_t> write_;
+    std::atomic<size_t> flush_to_;
+};
+}
+
+#endif // FF_PCM_RING_H
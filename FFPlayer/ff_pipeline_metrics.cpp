@@ -0,0 +1 @@
+#include "ff_pipeline_metrics.h"
@@ -0,0 +1,214 @@
+#ifndef FF_PIPELINE_METRICS_H
+#define FF_PIPELINE_METRICS_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include "ff_latency_histogram.h"
+
+namespace FFPlayer {
+class ff_pipeline_metrics {
+public:
+    typedef enum {
+        Demux_Stage = 0,
+        Decode_Stage,
+        Scale_Stage,
+        Watermark_Stage,
+        Queue_Wait_Stage,
+        Present_Stage,
+        Audio_Write_Stage,
+        Stage_Nb
+    } Stage;
+
+    typedef enum {
+        Frames_Decoded = 0,
+        Frames_Dropped,
+        Frames_Late,
+        Counter_Nb
+    } Counter;
+
+    typedef enum {
+        Text_Dump = 0,
+        Json_Dump
+    } Dump_Format;
+
+    class snapshot {
+    public:
+        unsigned long long timestamp = 0;
+        ff_latency_summary stages[Stage_Nb];
+        unsigned long long counters[Counter_Nb] = {0};
+        unsigned long long audio_underruns = 0;
+        unsigned long long audio_overruns = 0;
+        unsigned int video_queue_depth = 0;
+        unsigned int audio_queue_depth = 0;
+        double audio_buffered_seconds = 0.0;
+
+        std::string to_text() const {
+            std::ostringstream os;
+            os << "metrics @" << timestamp << "us" << std::endl;
+            for (unsigned int i = 0; i < Stage_Nb; i++) {
+                const ff_latency_summary& s = stages[i];
+                os << "  " << get_stage_name((Stage)i)
+                   << ": n=" << s.count
+                   << " mean=" << s.mean
+                   << " p50=" << s.p50
+                   << " p90=" << s.p90
+                   << " p99=" << s.p99
+                   << " p999=" << s.p999
+                   << " max=" << s.max << "us" << std::endl;
+            }
+            for (unsigned int i = 0; i < Counter_Nb; i++) {
+                os << "  " << get_counter_name((Counter)i) << ": " << counters[i] << std::endl;
+            }
+            os << "  audio_underruns: " << audio_underruns << std::endl
+               << "  audio_overruns: " << audio_overruns << std::endl
+               << "  video_queue_depth: " << video_queue_depth << std::endl
+               << "  audio_queue_depth: " << audio_queue_depth << std::endl
+               << "  audio_buffered_seconds: " << audio_buffered_seconds << std::endl;
+            return os.str();
+        }
+
+        std::string to_json() const {
+            std::ostringstream os;
+            os << "{\"timestamp_us\":" << timestamp << ",\"stages\":{";
+            for (unsigned int i = 0; i < Stage_Nb; i++) {
+                const ff_latency_summary& s = stages[i];
+                if (i) os << ",";
+                os << "\"" << get_stage_name((Stage)i) << "\":{"
+                   << "\"count\":" << s.count
+                   << ",\"min_us\":" << s.min
+                   << ",\"mean_us\":" << s.mean
+                   << ",\"p50_us\":" << s.p50
+                   << ",\"p90_us\":" << s.p90
+                   << ",\"p99_us\":" << s.p99
+                   << ",\"p999_us\":" << s.p999
+                   << ",\"max_us\":" << s.max << "}";
+            }
+            os << "},\"counters\":{";
+            for (unsigned int i = 0; i < Counter_Nb; i++) {
+                os << "\"" << get_counter_name((Counter)i) << "\":" << counters[i] << ",";
+            }
+            os << "\"audio_underruns\":" << audio_underruns
+               << ",\"audio_overruns\":" << audio_overruns
+               << "},\"gauges\":{"
+               << "\"video_queue_depth\":" << video_queue_depth
+               << ",\"audio_queue_depth\":" << audio_queue_depth
+               << ",\"audio_buffered_seconds\":" << audio_buffered_seconds
+               << "}}";
+            return os.str();
+        }
+    };
+
+    ff_pipeline_metrics():
+        enabled_(true),
+        dumping_(false),
+        gauge_cb_(nullptr) {
+        for (unsigned int i = 0; i < Counter_Nb; i++) counters_[i].store(0);
+    }
+
+    ~ff_pipeline_metrics() {
+        stop_dump();
+    }
+
+    void set_enabled(bool enabled) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool is_enabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    ff_latency_histogram *get_histogram(Stage stage) {
+        return is_enabled() ? &histograms_[stage] : nullptr;
+    }
+
+    void record(Stage stage, unsigned long long us) {
+        if (is_enabled()) histograms_[stage].record(us);
+    }
+
+    void count(Counter counter, unsigned long long nb = 1) {
+        if (is_enabled()) counters_[counter].fetch_add(nb, std::memory_order_relaxed);
+    }
+
+    void set_gauge_cb(std::function<void(snapshot&)> gauge_cb) {
+        gauge_cb_ = gauge_cb;
+    }
+
+    snapshot take_snapshot() const {
+        snapshot s;
+        s.timestamp = ff_latency_histogram::now();
+        for (unsigned int i = 0; i < Stage_Nb; i++) s.stages[i] = histograms_[i].summarize();
+        for (unsigned int i = 0; i < Counter_Nb; i++) s.counters[i] = counters_[i].load(std::memory_order_relaxed);
+        if (gauge_cb_) gauge_cb_(s);
+        return s;
+    }
+
+    void reset() {
+        for (unsigned int i = 0; i < Stage_Nb; i++) histograms_[i].reset();
+        for (unsigned int i = 0; i < Counter_Nb; i++) counters_[i].store(0, std::memory_order_relaxed);
+    }
+
+    void start_dump(unsigned int interval_ms,
+                    Dump_Format format,
+                    std::function<void(const std::string&)> dump_cb = nullptr) {
+        stop_dump();
+        if (!interval_ms) return;
+        dumping_.store(true);
+        std::thread t([this, interval_ms, format, dump_cb](){
+            std::unique_lock<std::mutex> lock(dump_m_);
+            while (!dump_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms), [this](){
+                return !dumping_.load();
+            })) {
+                snapshot s = take_snapshot();
+                std::string dump = format == Json_Dump ? s.to_json() : s.to_text();
+                if (dump_cb) dump_cb(dump);
+                else std::cout << dump << std::endl;
+            }
+        });
+        dump_thr_.swap(t);
+    }
+
+    void stop_dump() {
+        {
+            std::unique_lock<std::mutex> lock(dump_m_);
+            dumping_.store(false);
+            dump_cv_.notify_all();
+        }
+        if (dump_thr_.joinable()) dump_thr_.join();
+    }
+
+    static const char *get_stage_name(Stage stage) {
+        static const char *names[Stage_Nb] = {
+            "demux", "decode", "scale", "watermark", "queue_wait", "present", "audio_write"
+        };
+        return names[stage];
+    }
+
+    static const char *get_counter_name(Counter counter) {
+        static const char *names[Counter_Nb] = {
+            "frames_decoded", "frames_dropped", "frames_late"
+        };
+        return names[counter];
+    }
+
+private:
+    ff_pipeline_metrics(const ff_pipeline_metrics&);
+    ff_pipeline_metrics& operator =(const ff_pipeline_metrics&);
+    std::atomic_bool enabled_;
+    ff_latency_histogram histograms_[Stage_Nb];
+    std::atomic_ullong counters_[Counter_Nb];
+    std::mutex dump_m_;
+    std::condition_variable dump_cv_;
+    std::atomic_bool dumping_;
+    std::thread dump_thr_;
+    std::function<void(snapshot&)> gauge_cb_;
+};
+}
+
+#endif // FF_PIPELINE_METRICS_H
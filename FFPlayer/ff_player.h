@@ -1,12 +1,22 @@
 #ifndef FF_PLAYER_H
 #define FF_PLAYER_H
 
+#include <string.h>
+#include <memory>
 #include "ff_player_base.h"
 #include "ff_asyn_timer.h"
 #include "ff_player_face.h"
 #include "ff_asyn_decoder.h"
-#include "ff_blocking_audio_player.h"
+#include "ff_audio_engine.h"
 #include "task_pool_sync.h"
+#include "ff_playlist.h"
+#include "ff_scrub_previewer.h"
+#include "ff_thumbnail_engine.h"
+#include "ff_waveform_analyzer.h"
+#include "ff_frame_cache.h"
+#include "ff_gop_cache.h"
+#include "ff_pipeline_metrics.h"
+#include "ff_tracer.h"
 #include "ff_confi.h"
 
 namespace FFPlayer {
@@ -16,151 +26,204 @@ public:
               const char *file,
               const unsigned int dest_width = 400,
               const unsigned int dest_height = 300,
-              const unsigned int out_sample_rate = 8000):
+              const unsigned int out_sample_rate = 0):
         ff_player_base(app,
                        file,
                        dest_width,
                        dest_height,
                        out_sample_rate),
-        queue_(new ff_safe_queue<ff_decoder_base::frame_args>(ff_player_queue_default_max_size)),
+        video_queue_(make_queue()),
+        audio_queue_(make_queue()),
         timer_(ff_player_timer_default_loop_microseconds,
                true,[this](void *arg){return timer_task(arg);}),
         face_(this),
-        decoder_(file,
-                 queue_,
-                 dest_width,
-                 dest_height,
-                 out_sample_rate),
-        audio_player_(ff_blocking_audio_player::get_audio_player()),
+        decoder_(new ff_asyn_decoder(file,
+                                     video_queue_,
+                                     audio_queue_,
+                                     dest_width,
+                                     dest_height,
+                                     out_sample_rate_)),
+        preroll_decoder_(new ff_asyn_decoder(file,
+                                             make_queue(),
+                                             make_queue(),
+                                             dest_width,
+                                             dest_height,
+                                             out_sample_rate_)),
+        playing_decoder_(decoder_.get()),
+        preroll_ready_(false),
+        preroll_forward_(true),
+        paused_(false),
+        audio_player_(new ff_audio_engine::source),
         closed_cb_(NULL),
         atp_(ff_player_task_pool_default_max_size),
         vtp_(ff_player_task_pool_default_max_size),
-        uitp_(ff_player_task_pool_default_max_size) {
-        decoder_.set_seek_cb([this]() {
-            if (seek_starting_.load()) {
-                if (seek_pos_.load()-1.0<=0.0 && seek_pos_.load()-1.0>=-1.0) {
-                    seek_starting_.store(false);
-                    file_in_playing_ = file_;
-                    decoder_.clear_buffer();
-                    decoder_.cancel();
-                    return true;
-                }
-                if (face_.player_slider_.maximum()-seek_pos_.load() <= 1) {
-                    seek_starting_.store(false);
-                    decoder_.clear_buffer();
-                    decoder_.cancel();
-                    return true;
-                }
-                if (decoder_.seek_video(decoder_.get_duration()/(double)(face_.player_slider_.maximum())\
-                                        *(double)seek_pos_.load())) {
-                    decoder_.set_unend();
-                    seek_starting_.store(false);
-                    decoder_.clear_buffer();
-                    tem_fa_.ft = ff_decoder_base::Unknow_Frame;
-                    ff_decoder_base::frame_queue pq;
-                    if (!decoder_.decode_packet(pq)) return false;
-                    ff_decoder_base::frame_args fa = pq.queue.front();
-                    timer_interval_.store(fa.position*1000);
-                    for (int i = 0; i < pq.queue.size(); i++) {
-                        if (!queue_->enpacket_with_sort(pq.queue, [](const ff_decoder_base::frame_args& fa1,
-                                                                     const ff_decoder_base::frame_args& fa2){
-                            return fa1.position < fa2.position;
-                        })) return false;
-                    }
-                    return true;
+        uitp_(ff_player_task_pool_default_max_size),
+        ptp_(ff_player_task_pool_default_max_size),
+        stp_(ff_player_task_pool_default_max_size),
+        scrubber_(dest_width/ff_player_scrub_preview_divisor,
+                  dest_height/ff_player_scrub_preview_divisor),
+        thumbnails_(dest_width/ff_player_scrub_preview_divisor,
+                    dest_height/ff_player_scrub_preview_divisor,
+                    ff_thumbnail_default_count),
+        frame_cache_(ff_player_frame_cache_default_bytes),
+        frame_cache_generation_(0),
+        gop_cache_(dest_width, dest_height, ff_player_gop_cache_default_bytes),
+        cached_seek_pos_(-1.0),
+        displayed_pos_(0.0) {
+        set_decoder_cb(decoder_.get());
+        set_decoder_cb(preroll_decoder_.get());
+        decoder_->set_metrics(&metrics_);
+        preroll_decoder_->set_metrics(&metrics_);
+        metrics_.set_enabled(ff_metrics_default_enabled);
+        metrics_.set_gauge_cb([this](ff_pipeline_metrics::snapshot& s){
+            ff_asyn_decoder *dec = playing_decoder_.load();
+            s.video_queue_depth = dec->get_video_queue()->get_size();
+            s.audio_queue_depth = dec->get_audio_queue()->get_size();
+            s.audio_underruns = audio_player_->get_underruns();
+            s.audio_overruns = audio_player_->get_overruns();
+            s.audio_buffered_seconds = audio_player_->get_buffered_seconds();
+        });
+        metrics_.start_dump(ff_metrics_default_dump_interval_ms,
+                            ff_metrics_default_dump_json ? ff_pipeline_metrics::Json_Dump :
+                                                           ff_pipeline_metrics::Text_Dump);
+        decoder_->set_audio_format(audio_format_.sample_fmt, audio_format_.channel_layout);
+        preroll_decoder_->set_audio_format(audio_format_.sample_fmt, audio_format_.channel_layout);
+        set_memory_budget(ff_player_default_memory_budget);
+        scrubber_.set_preview_cb([this](const uint8_t *picture,
+                                        unsigned int width,
+                                        unsigned int height,
+                                        double){
+            if (!face_.player_slider_.isSliderDown()) return;
+            QPixmap qmp;
+            ff_pixel_format_transformer::rgb888_to_qig(picture, width, height, qmp);
+            face_.content_face_.setPixmap(qmp);
+        });
+        thumbnails_.set_generated_cb([this](const std::string& file, bool generated){
+            if (generated && file == get_file()) load_thumbnails();
+        });
+        waveforms_.set_analyzed_cb([this](const std::string& file, bool analyzed){
+            if (analyzed && file == get_file()) load_waveform();
+        });
+    }
+
+    void set_decoder_cb(ff_asyn_decoder *dec) {
+        dec->set_seek_cb([this, dec](double pos) {
+            if (dec != playing_decoder_.load()) return true;
+            if (dec->is_reverse()) {
+                vtp_.clear();
+                atp_.clear();
+                flush_audio();
+                dec->clear_buffer();
+                clear_heads();
+                timer_interval_.store(pos*1000);
+                seek_latency_start_.store(dec->get_seek_timestamp());
+                return dec->start_reverse(std::min(pos, dec->get_duration()));
+            }
+            if (pos >= dec->get_duration()) {
+                dec->clear_buffer();
+                dec->cancel();
+                return true;
+            }
+            vtp_.clear();
+            atp_.clear();
+            flush_audio();
+            if (dec->seek_video(pos)) {
+                dec->set_unend();
+                dec->clear_buffer();
+                clear_heads();
+                ff_decoder_base::frame_queue pq;
+                while (pq.queue.empty()) {
+                    if (dec->seek_pending()) return true;
+                    if (!dec->decode_packet(pq)) return false;
                 }
-                return false;
+                ff_decoder_base::frame_args fa = pq.queue.front();
+                timer_interval_.store(fa.position*1000);
+                set_pcm_origin(std::max(0.0, pos)*audio_format_.get_bytes_per_second());
+                seek_latency_start_.store(dec->get_seek_timestamp());
+                if (!dec->get_queue(pq.type)->enpacket_with_sort(pq.queue, [](const ff_decoder_base::frame_args& fa1,
+                                                                             const ff_decoder_base::frame_args& fa2){
+                    return fa1.position < fa2.position;
+                })) return dec->seek_pending();
+                return true;
             }
-            return true;
+            return false;
         });
-        decoder_.set_end_decode_cb([this]() {
+        dec->set_end_decode_cb([this, dec]() {
+            if (dec != playing_decoder_.load()) return;
             std::cout << "decode end." << std::endl;
-            if (decoder_.is_canceled()) {
-                decoder_.cancel();
-                uitp_.close([this](void*){std::cout<<"uitp_ closed."<<std::endl;uitp_.reset();});
-                vtp_.close([this](void*){std::cout<<"vtp_ closed."<<std::endl;vtp_.reset();});
-                atp_.close([this](void*){std::cout<<"atp_ closed."<<std::endl;atp_.reset();});
-                if (audio_player_->stop()) {audio_player_->close();}
-                std::cout<<"audio_player_ closed."<<std::endl;
-                timer_.cancel([this](ff_asyn_timer*){
-                    std::cout<<"timer_ closed."<<std::endl;
-                    decoder_.reset(file_in_playing_);
-                    av_playing_closed_cb();
-                    return true;
-                });
+            if (dec->is_canceled()) {
+                dec->cancel();
+                close_playing();
             }
         });
     }
 
     void* timer_task(void*) {
-        timer_interval_.fetch_add(ff_player_timer_default_loop_microseconds);
-        if (decoder_.is_end()) {
-            if (queue_->get_size() == 0) {
-                player_next(file_);
-                uitp_.close([this](void*){std::cout<<"uitp_ closed."<<std::endl;uitp_.reset();});
-                vtp_.close([this](void*){std::cout<<"vtp_ closed."<<std::endl;vtp_.reset();});
-                atp_.close([this](void*){std::cout<<"atp_ closed."<<std::endl;atp_.reset();});
-                if (audio_player_->stop()) {audio_player_->close();}
-                std::cout<<"audio_player_ closed."<<std::endl;
-                timer_.cancel([this](ff_asyn_timer*){
-                    std::cout<<"timer_ closed."<<std::endl;
-                    decoder_.reset(file_);
-                    av_playing_closed_cb();
-                    return true;
-                });
-            }
-        }
-        if (tem_fa_.ft==ff_decoder_base::Unknow_Frame) queue_->dequeue(tem_fa_);
-        if (tem_fa_.position*1000.0 <= timer_interval_.load()) {
-            ff_asyn_decoder::frame_args fa = tem_fa_;
-            if (tem_fa_.ft == ff_asyn_decoder::Video_Frame && tem_fa_.size > 0) {
-                vtp_.add_task([this, fa](){
-                    if (!fa.video_stream->consume(vb_, fa.size)) return;
-                    QPixmap qmp;
-                    ff_pixel_format_transformer::rgb888_to_qig(vb_,
-                                                               decoder_.get_dest_width(),
-                                                               decoder_.get_dest_height(),
-                                                               qmp);
-                    if (!resized_.load()) {
-                        face_.content_face_.setPixmap(qmp);
-                    }
-                    resized_.store(false);
-                });
-            } else if (tem_fa_.ft == ff_asyn_decoder::Audio_Frame && tem_fa_.size > 0) {
-                ff_asyn_decoder::frame_args fa = tem_fa_;
-                atp_.add_task([this, fa]{
-                    while (audio_player_->write_available()>=ab_total_len_ \
-                           && !fa.audio_stream->is_canceled()) {
-                        if (fa.audio_stream->valid_len() >= ab_total_len_) {
-                            if (consumed_pcm_len_/((double)out_sample_rate_*2.0)<=(fa.position+fa.duration)) {
-                                consumed_pcm_len_ += ab_total_len_;
-                                if (!fa.audio_stream->consume(ab_, ab_total_len_)) break;
-                                if (!audio_player_->play(ab_)) break;
-                            } else {
-                                if (!audio_player_->play((void*)ff_audio_default_output_fake_data)) break;
-                            }
-                        }
-                    }
-                });
-            }
-            uitp_.add_task([this, fa](){
-                if (!face_.player_slider_.isSliderDown()) {
-                    double ui_max_pos = face_.player_slider_.maximum();
-                    face_.player_slider_.setSliderPosition(fa.position/(decoder_.get_duration()/ui_max_pos));
-                }
-            });
-            tem_fa_.ft = ff_decoder_base::Unknow_Frame;
+        ff_tracer::set_thread_name("timer");
+        std::string switch_file;
+        {
+            std::unique_lock<std::mutex> lock(switch_m_);
+            switch_file.swap(switch_file_);
+        }
+        if (!switch_file.empty()) {
+            if (switch_to_preroll(switch_file, false)) return (void*)0;
+            reopen(switch_file);
+        }
+        if (tem_vfa_.ft == ff_decoder_base::Unknow_Frame && video_queue_->try_dequeue(tem_vfa_)) record_queue_wait(tem_vfa_);
+        if (tem_afa_.ft == ff_decoder_base::Unknow_Frame && audio_queue_->try_dequeue(tem_afa_)) record_queue_wait(tem_afa_);
+        bool starving = tem_vfa_.ft == ff_decoder_base::Unknow_Frame &&
+                        tem_afa_.ft == ff_decoder_base::Unknow_Frame &&
+                        !decoder_->is_end();
+        bool reverse = decoder_->is_reverse();
+        if (!starving) {
+            double clock_advance = ff_player_timer_default_loop_microseconds*rate_.load()+clock_remainder_;
+            unsigned int clock_step = (unsigned int)clock_advance;
+            clock_remainder_ = clock_advance-clock_step;
+            if (reverse) {
+                unsigned int clock = timer_interval_.load();
+                timer_interval_.store(clock > clock_step ? clock-clock_step : 0);
+            } else {
+                timer_interval_.fetch_add(clock_step);
+            }
+        }
+        if (decoder_->is_end() && !decoder_->is_canceled()) {
+            if (decoder_->queues_empty() &&
+                tem_vfa_.ft == ff_decoder_base::Unknow_Frame &&
+                tem_afa_.ft == ff_decoder_base::Unknow_Frame) {
+                std::string next_file = playlist_.empty() ? get_file() : playlist_.next();
+                preroll_forward_.store(true);
+                if (switch_to_preroll(next_file, true)) return (void*)0;
+                reopen(next_file);
+                close_playing();
+            }
+        }
+        unsigned int clock = timer_interval_.load();
+        if (is_due(tem_vfa_, clock, reverse)) {
+            if (ff_tracer::enabled()) ff_tracer::instant("video_due", tem_vfa_.position);
+            if (tem_vfa_.size > 0) present_video(tem_vfa_);
+            update_slider(tem_vfa_);
+            tem_vfa_.ft = ff_decoder_base::Unknow_Frame;
+        }
+        if (is_due(tem_afa_, clock, reverse)) {
+            if (ff_tracer::enabled()) ff_tracer::instant("audio_due", tem_afa_.position);
+            if (tem_afa_.size > 0) refill_audio(tem_afa_);
+            update_slider(tem_afa_);
+            tem_afa_.ft = ff_decoder_base::Unknow_Frame;
         }
         return (void*)0;
     }
 
-    ~ff_player() {}
+    ~ff_player() {
+        metrics_.stop_dump();
+    }
 
     bool start_up_audio_player() {
-        audio_player_->set_channel_nb(ff_audio_default_output_channel_nb);
-        audio_player_->set_frames_per_buffer(ff_audio_deafult_output_frames_per_buffer_nb);
+        if (audio_player_->is_started()) return true;
+        audio_player_->set_channel_nb(audio_format_.get_channel_nb());
+        audio_player_->set_frames_per_buffer(ff_audio_default_callback_frames_per_buffer_nb);
         audio_player_->set_sample_rate(out_sample_rate_);
-        audio_player_->set_sample_format(ff_audio_default_output_sample_format);
+        audio_player_->set_sample_format(audio_format_.get_pa_format());
+        audio_player_->set_ring_seconds(ff_audio_default_ring_seconds);
         if (audio_player_->prepare()) {
             if (audio_player_->start()) return true;
         }
@@ -172,8 +235,14 @@ public:
             atp_.start();
             vtp_.start();
             uitp_.start();
-            if (decoder_.start()) {
+            ptp_.start();
+            stp_.start();
+            scrubber_.start();
+            if (decoder_->start()) {
                 timer_.start();
+                load_thumbnails();
+                load_waveform();
+                schedule_preroll();
                 return true;
             }
         }
@@ -182,66 +251,538 @@ public:
 
     void close(std::function<void(ff_player *)> closed_cb) {
         closed_cb_ = closed_cb;
-        decoder_.cancel();
+        std::unique_lock<std::mutex> lock(decoder_m_);
+        decoder_->cancel();
+    }
+
+    void set_playlist(const std::vector<std::string>& files) {
+        playlist_.set_files(files, get_file());
+        for (auto& file: files) {
+            thumbnails_.generate(file);
+            waveforms_.analyze(file);
+        }
+        schedule_preroll();
     }
+
     virtual void player_pause() override {
+        paused_.store(true);
         timer_.cancel(nullptr);
     }
     virtual void player_start() override {
+        double cached_seek_pos = cached_seek_pos_.exchange(-1.0);
+        if (cached_seek_pos >= 0.0) playing_decoder_.load()->request_seek(cached_seek_pos);
+        paused_.store(false);
         timer_.start();
     }
     virtual void player_next(const char *next_file) override {
-        file_in_playing_ = next_file;
-        close([this](ff_player *){
-            std::cout<<"player closed."<<std::endl;
-            play();
-        });
+        std::string file = next_file ? next_file : "";
+        if (file.empty()) file = playlist_.next();
+        if (file.empty()) return;
+        preroll_forward_.store(true);
+        switch_file(file);
     }
     virtual void player_last(const char *last_file) override {
-        file_in_playing_ = last_file;
-        close([this](ff_player *){
-            std::cout<<"player closed."<<std::endl;
-            play();
-        });
+        std::string file = last_file ? last_file : "";
+        if (file.empty()) file = playlist_.last();
+        if (file.empty()) return;
+        preroll_forward_.store(false);
+        switch_file(file);
     }
     virtual void player_slide(int pos) override {
         seek_pos_.store(pos);
+        ff_asyn_decoder *dec = playing_decoder_.load();
+        double ui_max_pos = face_.player_slider_.maximum();
+        double preview_pos = dec->get_duration()/ui_max_pos*(double)pos;
+        show_thumbnail(preview_pos);
+        scrubber_.request(get_file().c_str(), preview_pos);
     }
     virtual void slider_release() override {
-        seek_starting_.store(true);
+        scrubber_.cancel();
+        ff_asyn_decoder *dec = playing_decoder_.load();
+        double ui_max_pos = face_.player_slider_.maximum();
+        double pos = 0.0;
+        if (seek_pos_.load() > 1) {
+            if (ui_max_pos-seek_pos_.load() <= 1) pos = dec->get_duration();
+            else pos = dec->get_duration()/ui_max_pos*(double)seek_pos_.load();
+        }
+        if (show_cached_frame(pos) && paused_.load()) {
+            cached_seek_pos_.store(pos);
+            return;
+        }
+        cached_seek_pos_.store(-1.0);
+        dec->request_seek(pos);
+    }
+
+    virtual void step_forward() override {
+        step_frame(true);
+    }
+
+    virtual void step_backward() override {
+        step_frame(false);
+    }
+
+    bool set_audio_sink(std::unique_ptr<ff_audio_sink> audio_sink) {
+        if (!audio_sink || audio_player_->is_started()) return false;
+        audio_player_.swap(audio_sink);
+        return true;
+    }
+
+    ff_audio_sink& get_audio_sink() {
+        return *audio_player_;
+    }
+
+    void set_volume(float volume) {
+        audio_player_->set_gain(volume);
+    }
+
+    float get_volume() const {
+        return audio_player_->get_gain();
+    }
+
+    void set_playback_rate(double rate) {
+        rate = std::max(ff_player_min_playback_rate, std::min(ff_player_max_playback_rate, rate));
+        rate_.store(rate);
+        std::unique_lock<std::mutex> lock(decoder_m_);
+        decoder_->set_rate(rate);
+        preroll_decoder_->set_rate(rate);
+    }
+
+    double get_playback_rate() const {
+        return rate_.load();
+    }
+
+    void set_memory_budget(size_t memory_budget) {
+        std::unique_lock<std::mutex> lock(decoder_m_);
+        decoder_->set_memory_budget(memory_budget/2);
+        preroll_decoder_->set_memory_budget(memory_budget/2);
+    }
+
+    size_t get_buffer_memory() {
+        std::unique_lock<std::mutex> lock(decoder_m_);
+        return decoder_->get_buffer_memory()+
+               preroll_decoder_->get_buffer_memory()+
+               frame_cache_.get_bytes()+
+               gop_cache_.get_frames().get_bytes()+
+               ab_total_len_+
+               vb_total_len_;
+    }
+
+    void set_reverse(bool reverse) {
+        ff_asyn_decoder *dec = playing_decoder_.load();
+        if (dec->is_reverse() == reverse) return;
+        dec->set_reverse(reverse);
+        dec->request_seek(displayed_pos_.load());
+        if (paused_.load()) player_start();
+    }
+
+    bool is_reverse() {
+        return playing_decoder_.load()->is_reverse();
+    }
+
+    ff_frame_cache& get_frame_cache() {
+        return frame_cache_;
+    }
+
+    unsigned long long get_audio_underruns() const {
+        return audio_player_->get_underruns();
+    }
+
+    unsigned long long get_audio_overruns() const {
+        return audio_player_->get_overruns();
+    }
+
+    ff_pipeline_metrics::snapshot get_metrics_snapshot() const {
+        return metrics_.take_snapshot();
+    }
+
+    ff_pipeline_metrics& get_metrics() {
+        return metrics_;
+    }
+
+    void set_tracing(bool enabled) {
+        ff_tracer::set_enabled(enabled);
+    }
+
+    bool export_trace(const char *file) {
+        return ff_tracer::export_json(file);
+    }
+
+    std::shared_ptr<ff_waveform> get_waveform() {
+        std::unique_lock<std::mutex> lock(waveform_m_);
+        return waveform_;
+    }
+
+    double get_audio_output_latency() {
+        return audio_player_->get_output_latency()+audio_player_->get_buffered_seconds();
+    }
+
+    unsigned long long get_last_seek_latency() const {
+        return last_seek_latency_.load();
+    }
+
+    void set_seek_latency_cb(std::function<void(unsigned long long)> seek_latency_cb) {
+        seek_latency_cb_ = seek_latency_cb;
     }
     virtual void player_resize() override {
         resized_.store(true);
     }
-    virtual void player_close() override {}
+    virtual void player_close() override {
+        if (audio_player_->stop()) {audio_player_->close();}
+        std::cout<<"audio_player_ closed."<<std::endl;
+    }
 
 protected:
+    static std::shared_ptr<ff_asyn_decoder::frame_args_queue> make_queue() {
+        return std::make_shared<ff_asyn_decoder::frame_args_queue>(ff_player_queue_default_max_size);
+    }
+
+    void clear_heads() {
+        tem_vfa_ = ff_decoder_base::frame_args();
+        tem_afa_ = ff_decoder_base::frame_args();
+    }
+
+    static bool is_due(const ff_decoder_base::frame_args& fa, unsigned int clock, bool reverse) {
+        if (fa.ft == ff_decoder_base::Unknow_Frame) return false;
+        return reverse ? fa.position*1000.0 >= clock : fa.position*1000.0 <= clock;
+    }
+
+    void present_video(const ff_decoder_base::frame_args& fa) {
+        unsigned long long generation = frame_cache_generation_.load();
+        vtp_.add_task([this, fa, generation](){
+            ff_tracer::set_thread_name("video tasks");
+            ff_trace_scope trace("present", fa.position);
+            double clock = timer_interval_.load()/1000.0;
+            bool reverse = playing_decoder_.load()->is_reverse();
+            if (!reverse && fa.position+fa.duration+ff_player_video_late_seconds < clock) {
+                fa.video_stream->consume(NULL, fa.size);
+                metrics_.count(ff_pipeline_metrics::Frames_Dropped);
+                return;
+            }
+            if (!reverse && fa.position+fa.duration < clock) metrics_.count(ff_pipeline_metrics::Frames_Late);
+            ff_latency_histogram::scope scope(metrics_.get_histogram(ff_pipeline_metrics::Present_Stage));
+            ff_frame_cache::buffer picture = frame_cache_.acquire(vb_total_len_);
+            if (!fa.video_stream->consume(picture->data(), fa.size)) return;
+            report_seek_latency();
+            if (!resized_.load() && !face_.player_slider_.isSliderDown()) {
+                present_frame(picture->data());
+                displayed_pos_.store(fa.position);
+            }
+            resized_.store(false);
+            if (generation == frame_cache_generation_.load()) {
+                frame_cache_.insert(fa.position, fa.duration, picture);
+            }
+        });
+    }
+
+    void flush_audio() {
+        audio_generation_.fetch_add(1);
+        audio_player_->flush();
+    }
+
+    void set_pcm_origin(double origin) {
+        pcm_origin_.store(origin);
+        pcm_origin_generation_.fetch_add(1);
+    }
+
+    void refill_audio(const ff_decoder_base::frame_args& fa) {
+        atp_.add_task([this, fa]{
+            ff_tracer::set_thread_name("audio tasks");
+            ff_trace_scope trace("audio_write", fa.position);
+            ff_latency_histogram::scope scope(metrics_.get_histogram(ff_pipeline_metrics::Audio_Write_Stage));
+            unsigned long long generation = audio_generation_.load();
+            if (ab_generation_ != generation) {
+                ab_generation_ = generation;
+                ab_pending_ = false;
+            }
+            unsigned long long origin_generation = pcm_origin_generation_.load();
+            if (consumed_generation_ != origin_generation) {
+                consumed_generation_ = origin_generation;
+                consumed_pcm_len_ = pcm_origin_.load();
+            }
+            if (ab_pending_) {
+                if (!audio_player_->write(ab_, ab_total_len_)) return;
+                ab_pending_ = false;
+            }
+            while (!fa.audio_stream->is_canceled() &&
+                   fa.audio_stream->valid_len() > ab_total_len_ &&
+                   consumed_pcm_len_/audio_format_.get_bytes_per_second() <= fa.position+fa.duration) {
+                consumed_pcm_len_ += ab_total_len_*rate_.load();
+                if (!fa.audio_stream->consume(ab_, ab_total_len_)) break;
+                if (!audio_player_->write(ab_, ab_total_len_)) {
+                    ab_pending_ = true;
+                    break;
+                }
+            }
+        });
+    }
+
+    void record_queue_wait(const ff_decoder_base::frame_args& fa) {
+        if (fa.timestamp) metrics_.record(ff_pipeline_metrics::Queue_Wait_Stage, ff_latency_histogram::now()-fa.timestamp);
+    }
+
+    void update_slider(const ff_decoder_base::frame_args& fa) {
+        double duration = decoder_->get_duration();
+        uitp_.add_task([this, fa, duration](){
+            ff_tracer::set_thread_name("ui tasks");
+            ff_trace_scope trace("update_slider", fa.position);
+            if (!face_.player_slider_.isSliderDown()) {
+                double ui_max_pos = face_.player_slider_.maximum();
+                face_.player_slider_.setSliderPosition(fa.position/(duration/ui_max_pos));
+            }
+        });
+    }
+
+    void switch_file(const std::string& file) {
+        std::unique_lock<std::mutex> preroll_lock(preroll_m_, std::try_to_lock);
+        if (preroll_lock.owns_lock() && preroll_ready_.load() && file == preroll_decoder_->get_file()) {
+            preroll_lock.unlock();
+            {
+                std::unique_lock<std::mutex> lock(switch_m_);
+                switch_file_ = file;
+            }
+            if (paused_.load()) player_start();
+            return;
+        }
+        if (preroll_lock.owns_lock()) preroll_lock.unlock();
+        reopen(file);
+    }
+
+    void reopen(const std::string& file) {
+        set_playing_file(file);
+        close([this](ff_player *){
+            std::cout<<"player closed."<<std::endl;
+            play();
+        });
+    }
+
+    void close_playing() {
+        uitp_.close([this](void*){std::cout<<"uitp_ closed."<<std::endl;uitp_.reset();});
+        vtp_.close([this](void*){std::cout<<"vtp_ closed."<<std::endl;vtp_.reset();});
+        atp_.close([this](void*){std::cout<<"atp_ closed."<<std::endl;atp_.reset();});
+        timer_.cancel([this](ff_asyn_timer*){
+            std::cout<<"timer_ closed."<<std::endl;
+            decoder_->reset(get_playing_file().c_str());
+            av_playing_closed_cb();
+            return true;
+        });
+    }
+
+    bool switch_to_preroll(const std::string& file, bool gapless) {
+        std::unique_lock<std::mutex> lock(preroll_m_, std::try_to_lock);
+        if (!lock.owns_lock() || !preroll_ready_.load()) return false;
+        if (file != preroll_decoder_->get_file()) return false;
+        preroll_ready_.store(false);
+        {
+            std::unique_lock<std::mutex> decoder_lock(decoder_m_);
+            decoder_.swap(preroll_decoder_);
+            video_queue_ = decoder_->get_video_queue();
+            audio_queue_ = decoder_->get_audio_queue();
+            playing_decoder_.store(decoder_.get());
+        }
+        set_playing_file(file);
+        reset();
+        lock.unlock();
+        load_thumbnails();
+        load_waveform();
+        if (gapless) {
+            atp_.add_task([this](){
+                vtp_.add_task([this](){schedule_preroll();});
+            });
+        } else {
+            preroll_decoder_->cancel();
+            vtp_.clear();
+            atp_.clear();
+            flush_audio();
+            schedule_preroll();
+        }
+        std::cout << "switched to preroll: " << file << std::endl;
+        return true;
+    }
+
+    void schedule_preroll() {
+        std::string file = preroll_forward_.load() ? playlist_.peek_next() : playlist_.peek_last();
+        if (file.empty()) return;
+        ptp_.add_task([this, file](){preroll(file);});
+    }
+
+    void preroll(const std::string& file) {
+        ff_tracer::set_thread_name("preroll tasks");
+        ff_trace_scope trace("preroll");
+        std::unique_lock<std::mutex> lock(preroll_m_);
+        ff_asyn_decoder *dec = preroll_decoder_.get();
+        if (preroll_ready_.load()) {
+            if (file == dec->get_file()) return;
+            preroll_ready_.store(false);
+        }
+        dec->cancel();
+        dec->join();
+        dec->reset(file.c_str());
+        if (dec->start()) {
+            preroll_ready_.store(true);
+            std::cout << "preroll ready: " << file << std::endl;
+        }
+    }
+
+    void load_thumbnails() {
+        std::string file = get_file();
+        std::shared_ptr<ff_thumbnail_strip> strip = thumbnails_.load(file.c_str());
+        if (!strip) thumbnails_.generate(file);
+        std::unique_lock<std::mutex> lock(thumbnail_m_);
+        thumbnail_strip_ = strip;
+    }
+
+    void load_waveform() {
+        std::string file = get_file();
+        std::shared_ptr<ff_waveform> waveform = waveforms_.load(file.c_str());
+        if (!waveform) waveforms_.analyze(file);
+        {
+            std::unique_lock<std::mutex> lock(waveform_m_);
+            waveform_ = waveform;
+        }
+        uitp_.add_task([this, waveform](){face_.player_slider_.set_waveform(waveform);});
+    }
+
+    void show_thumbnail(double pos) {
+        std::shared_ptr<ff_thumbnail_strip> strip;
+        {
+            std::unique_lock<std::mutex> lock(thumbnail_m_);
+            strip = thumbnail_strip_;
+        }
+        if (!strip) return;
+        int i = strip->nearest(pos);
+        if (i < 0) return;
+        QPixmap qmp;
+        ff_pixel_format_transformer::rgb888_to_qig(strip->get_picture(i),
+                                                   strip->get_width(),
+                                                   strip->get_height(),
+                                                   qmp);
+        face_.content_face_.setPixmap(qmp);
+    }
+
+    bool show_cached_frame(double pos) {
+        ff_frame_cache::frame f;
+        if (!frame_cache_.find(pos, f)) return false;
+        present_frame(f.data->data());
+        displayed_pos_.store(f.position);
+        return true;
+    }
+
+    void step_frame(bool forward) {
+        if (!paused_.load()) player_pause();
+        stp_.add_task([this, forward](){
+            double pos = displayed_pos_.load();
+            ff_frame_cache::frame f;
+            if (forward || !frame_cache_.find_before(pos, f)) {
+                if (!gop_cache_.step(get_file().c_str(), pos, forward, f)) return;
+            }
+            present_frame(f.data->data());
+            displayed_pos_.store(f.position);
+            cached_seek_pos_.store(f.position);
+            double duration = playing_decoder_.load()->get_duration();
+            if (duration > 0.0) {
+                double ui_max_pos = face_.player_slider_.maximum();
+                face_.player_slider_.setSliderPosition(f.position/(duration/ui_max_pos));
+            }
+        });
+    }
+
+    void present_frame(const uint8_t *picture) {
+        QPixmap qmp;
+        ff_pixel_format_transformer::rgb888_to_qig(picture,
+                                                   dest_width_,
+                                                   dest_height_,
+                                                   qmp);
+        face_.content_face_.setPixmap(qmp);
+    }
+
+    void report_seek_latency() {
+        unsigned long long start = seek_latency_start_.exchange(0);
+        if (!start) return;
+        unsigned long long latency = ff_asyn_timer::get_timestamp()-start;
+        last_seek_latency_.store(latency);
+        std::cout << "seek to first frame: " << latency << "us" << std::endl;
+        if (seek_latency_cb_) seek_latency_cb_(latency);
+    }
+
     void av_playing_closed_cb() {
+        flush_audio();
         reset();
         if (closed_cb_) closed_cb_(this);
     }
 
+    std::string get_playing_file() {
+        std::unique_lock<std::mutex> lock(file_m_);
+        return file_in_playing_;
+    }
+
+    void set_playing_file(const std::string& file) {
+        std::unique_lock<std::mutex> lock(file_m_);
+        file_in_playing_ = file;
+    }
+
     void reset() {
-        file_ = file_in_playing_;
+        {
+            std::unique_lock<std::mutex> lock(file_m_);
+            file_ = file_in_playing_;
+        }
         timer_interval_.store(0);
-        consumed_pcm_len_ = 0.0;
-        tem_fa_ = ff_decoder_base::frame_args();;
-        seek_starting_.store(false);
+        clock_remainder_ = 0.0;
+        set_pcm_origin(0.0);
+        clear_heads();
         seek_pos_.store(0);
+        seek_latency_start_.store(0);
         resized_.store(false);
+        frame_cache_generation_.fetch_add(1);
+        frame_cache_.clear();
+        cached_seek_pos_.store(-1.0);
+        displayed_pos_.store(0.0);
         std::cout << "player reset." << std::endl;
     }
 
 private:
-    std::shared_ptr<ff_safe_queue<ff_decoder_base::frame_args>> queue_;
+    ff_pipeline_metrics metrics_;
+    std::shared_ptr<ff_asyn_decoder::frame_args_queue> video_queue_;
+    std::shared_ptr<ff_asyn_decoder::frame_args_queue> audio_queue_;
     ff_asyn_timer timer_;
     ff_player_face face_;
-    ff_asyn_decoder decoder_;
-    ff_blocking_audio_player *audio_player_;
+    std::unique_ptr<ff_asyn_decoder> decoder_;
+    std::unique_ptr<ff_asyn_decoder> preroll_decoder_;
+    std::mutex decoder_m_;
+    std::atomic<ff_asyn_decoder *> playing_decoder_;
+    std::mutex preroll_m_;
+    std::atomic_bool preroll_ready_;
+    std::atomic_bool preroll_forward_;
+    std::mutex switch_m_;
+    std::string switch_file_;
+    std::atomic_bool paused_;
+    ff_playlist playlist_;
+    std::unique_ptr<ff_audio_sink> audio_player_;
+    std::atomic_ullong audio_generation_ {0};
+    unsigned long long ab_generation_ = 0;
+    bool ab_pending_ = false;
     task_pool_sync atp_;
     task_pool_sync vtp_;
     task_pool_sync uitp_;
+    task_pool_sync ptp_;
+    task_pool_sync stp_;
+    ff_scrub_previewer scrubber_;
+    ff_thumbnail_engine thumbnails_;
+    std::mutex thumbnail_m_;
+    std::shared_ptr<ff_thumbnail_strip> thumbnail_strip_;
+    ff_waveform_analyzer waveforms_;
+    std::mutex waveform_m_;
+    std::shared_ptr<ff_waveform> waveform_;
+    ff_frame_cache frame_cache_;
+    std::atomic_ullong frame_cache_generation_;
+    ff_gop_cache gop_cache_;
+    std::atomic<double> cached_seek_pos_;
+    std::atomic<double> displayed_pos_;
+    std::atomic<double> rate_ {1.0};
+    double clock_remainder_ = 0.0;
     std::function<void(ff_player *)> closed_cb_ = nullptr;
+    std::atomic_ullong seek_latency_start_ {0};
+    std::atomic_ullong last_seek_latency_ {0};
+    std::function<void(unsigned long long)> seek_latency_cb_ = nullptr;
 };
 }
 
@@ -3,9 +3,12 @@
 
 #include <iostream>
 #include <atomic>
+#include <mutex>
+#include <string>
 #include <QApplication>
 #include "ff_player_event.h"
 #include "ff_decoder_base.h"
+#include "ff_audio_format.h"
 
 namespace FFPlayer {
 class ff_player_base: public ff_player_event {
@@ -14,24 +17,25 @@ public:
                    const char *file,
                    const unsigned int dest_width = 400,
                    const unsigned int dest_height = 300,
-                   const unsigned int out_sample_rate = 8000):
+                   const unsigned int out_sample_rate = 0):
         app_(app),
         file_(file),
+        file_in_playing_(file),
         dest_width_(dest_width),
         dest_height_(dest_height),
-        out_sample_rate_(out_sample_rate),
+        audio_format_(ff_audio_format::negotiate(out_sample_rate)),
+        out_sample_rate_(audio_format_.sample_rate),
         timer_interval_(0),
-        ab_total_len_(ff_audio_default_output_bytes_nb),
+        ab_total_len_(ff_audio_deafult_output_frames_per_buffer_nb*audio_format_.get_frame_bytes()),
         vb_total_len_(ff_data_size::get_video_buffer_size(dest_width,
                                                           dest_height,
                                                           ff_decode_default_output_pixel_format,
                                                           1)),
         ab_((int16_t *)malloc(ab_total_len_)),
         vb_((uint8_t *)malloc(vb_total_len_)),
-        seek_starting_(false),
         seek_pos_(0),
         resized_(false) {
-        assert(file_);
+        assert(!file_.empty());
         assert(ab_);
         assert(vb_);
     };
@@ -42,7 +46,8 @@ public:
     inline QApplication& get_app() {
         return app_;
     }
-    inline const char *get_file() {
+    inline std::string get_file() {
+        std::unique_lock<std::mutex> lock(file_m_);
         return file_;
     }
     inline unsigned int get_dest_width() {
@@ -54,15 +59,21 @@ public:
     inline unsigned int get_out_sample_rate() {
         return out_sample_rate_;
     }
+    inline const ff_audio_format& get_audio_format() const {
+        return audio_format_;
+    }
 private:
     ff_player_base();
     ff_player_base(const ff_player_base&);
     ff_player_base& operator =(const ff_player_base&);
 protected:
     QApplication& app_;
-    const char *file_;
+    std::mutex file_m_;
+    std::string file_;
+    std::string file_in_playing_;
     unsigned int dest_width_;
     unsigned int dest_height_;
+    ff_audio_format audio_format_;
     unsigned int out_sample_rate_;
     unsigned int ab_total_len_;
     unsigned int vb_total_len_;
@@ -70,11 +81,13 @@ protected:
     int16_t *ab_;
     uint8_t *vb_;
     double consumed_pcm_len_ = 0.0;
-    ff_decoder_base::frame_args tem_fa_;
-    std::atomic_bool seek_starting_;
+    unsigned long long consumed_generation_ = 0;
+    std::atomic<double> pcm_origin_ {0.0};
+    std::atomic_ullong pcm_origin_generation_ {0};
+    ff_decoder_base::frame_args tem_vfa_;
+    ff_decoder_base::frame_args tem_afa_;
     std::atomic_uint seek_pos_;
     std::atomic_bool resized_;
-    const char *file_in_playing_ = nullptr;
 };
 }
 
@@ -11,6 +11,8 @@ public:
     virtual void player_last(const char*) {}
     virtual void player_slide(int) {}
     virtual void slider_release() {}
+    virtual void step_forward() {}
+    virtual void step_backward() {}
     virtual void player_resize() {}
     virtual void player_close() {}
 };
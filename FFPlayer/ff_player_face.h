@@ -2,6 +2,8 @@
 #define FF_PLAYER_FACE_H
 
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <QApplication>
 #include <QDesktopWidget>
 #include <QImage>
@@ -10,7 +12,11 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QSlider>
+#include <QKeyEvent>
+#include <QPainter>
+#include <QPaintEvent>
 #include "ff_player_base.h"
+#include "ff_waveform_analyzer.h"
 
 namespace FFPlayer {
 class ff_player;
@@ -99,6 +105,16 @@ protected:
             player_next_but_.setGeometry((dest_width_-60)/2+90, dest_height_-70, 60, 60);
             player_last_but_.setGeometry((dest_width_-60)/2-90, dest_height_-70, 60, 60);
         }
+        if (e->type() == QEvent::Type::KeyPress) {
+            int key = static_cast<QKeyEvent *>(e)->key();
+            if (key == Qt::Key_Right || key == Qt::Key_Period) {
+                fpb_->step_forward();
+                player_but_.setText("Start");
+            } else if (key == Qt::Key_Left || key == Qt::Key_Comma) {
+                fpb_->step_backward();
+                player_but_.setText("Start");
+            }
+        }
         if (e->type() == QEvent::Type::Close) {
             fpb_->player_close();
             exit(0);
@@ -255,6 +271,14 @@ private:
         }
         ~ff_player_slider(){}
 
+        void set_waveform(std::shared_ptr<ff_waveform> waveform) {
+            {
+                std::unique_lock<std::mutex> lock(waveform_m_);
+                waveform_ = waveform;
+            }
+            update();
+        }
+
     protected:
         bool event(QEvent *e) {
             if (e->type() == QEvent::MouseButtonRelease) {
@@ -263,6 +287,28 @@ private:
             return QSlider::event(e);
         }
 
+        virtual void paintEvent(QPaintEvent *e) override {
+            std::shared_ptr<ff_waveform> waveform;
+            {
+                std::unique_lock<std::mutex> lock(waveform_m_);
+                waveform = waveform_;
+            }
+            if (waveform && waveform->get_bucket_nb()) {
+                QPainter painter(this);
+                painter.setPen(QColor(128, 160, 200));
+                unsigned int bucket_nb = waveform->get_bucket_nb();
+                int w = width();
+                int mid = height()/2;
+                for (int x = 0; x < w; x++) {
+                    unsigned int i = std::min<unsigned int>((unsigned int)((double)x*bucket_nb/w), bucket_nb-1);
+                    int top = mid-(int)(waveform->get_max(i)*mid);
+                    int bottom = mid-(int)(waveform->get_min(i)*mid);
+                    painter.drawLine(x, top, x, bottom);
+                }
+            }
+            QSlider::paintEvent(e);
+        }
+
         virtual void sliderChange(SliderChange change) override {
             if (change == SliderChange::SliderValueChange) {
                 if (isSliderDown()) {
@@ -274,6 +320,8 @@ private:
     private:
         std::function<void (QWidget *, int)> value_change_cb_;
         std::function<void (QWidget *)> slider_release_cb_;
+        std::mutex waveform_m_;
+        std::shared_ptr<ff_waveform> waveform_;
     };
     void get_screen_size() {
         QDesktopWidget* desktop_widget = QApplication::desktop();
@@ -0,0 +1,2 @@
+#include "ff_playlist.h"
+
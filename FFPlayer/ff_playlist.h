@@ -0,0 +1,80 @@
+#ifndef FF_PLAYLIST_H
+#define FF_PLAYLIST_H
+
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <string>
+
+namespace FFPlayer {
+class ff_playlist {
+public:
+    ff_playlist():
+        index_(0) {}
+
+    ~ff_playlist() {}
+
+    void set_files(const std::vector<std::string>& files, const std::string& current = std::string()) {
+        std::unique_lock<std::mutex> lock(m_);
+        files_ = files;
+        index_ = 0;
+        for (size_t i = 0; i < files_.size(); i++) {
+            if (files_[i] == current) {
+                index_ = i;
+                break;
+            }
+        }
+    }
+
+    bool empty() {
+        std::unique_lock<std::mutex> lock(m_);
+        return files_.empty();
+    }
+
+    size_t size() {
+        std::unique_lock<std::mutex> lock(m_);
+        return files_.size();
+    }
+
+    std::string current() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (files_.empty()) return std::string();
+        return files_[index_];
+    }
+
+    std::string next() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (files_.empty()) return std::string();
+        index_ = (index_+1)%files_.size();
+        return files_[index_];
+    }
+
+    std::string last() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (files_.empty()) return std::string();
+        index_ = (index_+files_.size()-1)%files_.size();
+        return files_[index_];
+    }
+
+    std::string peek_next() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (files_.empty()) return std::string();
+        return files_[(index_+1)%files_.size()];
+    }
+
+    std::string peek_last() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (files_.empty()) return std::string();
+        return files_[(index_+files_.size()-1)%files_.size()];
+    }
+
+private:
+    ff_playlist(const ff_playlist&);
+    ff_playlist& operator =(const ff_playlist&);
+    std::mutex m_;
+    std::vector<std::string> files_;
+    size_t index_;
+};
+}
+
+#endif // FF_PLAYLIST_H
@@ -9,8 +9,26 @@
 #include <atomic>
 #include <algorithm>
 #include <functional>
+#include <vector>
+#include <chrono>
+#include <iterator>
 
 namespace FFPlayer {
+class ff_queue_limit {
+public:
+    unsigned int max_count = 0;
+    size_t max_bytes = 0;
+    double max_duration = 0.0;
+};
+
+template<typename T>
+class ff_queue_meter {
+public:
+    std::function<unsigned int(const T&)> type_of = nullptr;
+    std::function<size_t(const T&)> bytes_of = nullptr;
+    std::function<double(const T&)> duration_of = nullptr;
+};
+
 template<typename T>
 class ff_queue_base {
 public:
@@ -37,17 +55,19 @@ public:
     }
 
     inline virtual bool enqueue(T&& t) {
-        if(max_size_ <= queue_.size()) {
+        if(max_size_ <= queue_.size() || !admits(t)) {
             return false;
         }
-        queue_.push_back(t);
+        account(t, true);
+        queue_.push_back(std::move(t));
         return true;
     }
 
     inline virtual bool enqueue(T& t) {
-        if(max_size_ <= queue_.size()) {
+        if(max_size_ <= queue_.size() || !admits(t)) {
             return false;
         }
+        account(t, true);
         queue_.push_back(t);
         return true;
     }
@@ -56,8 +76,9 @@ public:
         if (queue_.empty()) {
             return false;
         }
-        t = queue_.front();
+        t = std::move(queue_.front());
         queue_.pop_front();
+        account(t, false);
         return true;
     }
 
@@ -65,31 +86,90 @@ public:
         if (queue_.empty()) {
             return false;
         }
-        t = queue_.back();
+        t = std::move(queue_.back());
         queue_.pop_back();
+        account(t, false);
         return true;
     }
 
     inline virtual bool enpacket(std::deque<T>& que) {
-        if (que.size()+queue_.size() >= max_size_) {
+        if (que.size()+queue_.size() >= max_size_ || !admits(que.begin(), que.end())) {
             return false;
         }
         for (int i = 0; i < que.size(); i++) {
-            T t = que.at(i);
-            queue_.push_back(t);
+            account(que[i], true);
+            queue_.push_back(std::move(que[i]));
+        }
+        return true;
+    }
+
+    template<typename InputIt>
+    bool enqueue_bulk(InputIt begin, InputIt end) {
+        if (queue_.size()+std::distance(begin, end) > max_size_ || !admits(begin, end)) {
+            return false;
+        }
+        for (; begin != end; ++begin) {
+            account(*begin, true);
+            queue_.push_back(std::move(*begin));
         }
         return true;
     }
 
+    template<typename OutputIt>
+    unsigned int dequeue_bulk(OutputIt out, unsigned int max) {
+        unsigned int nb = 0;
+        while (nb < max && !queue_.empty()) {
+            account(queue_.front(), false);
+            *out++ = std::move(queue_.front());
+            queue_.pop_front();
+            nb++;
+        }
+        return nb;
+    }
+
     inline virtual void clear() {
         queue_.clear();
+        clear_usage();
     }
 
     inline virtual void reset(unsigned int max_size) {
         queue_.clear();
+        clear_usage();
         max_size_ = max_size;
     }
 
+    void set_limits(const ff_queue_meter<T>& meter,
+                    const std::vector<ff_queue_limit>& limits,
+                    double low_watermark_ratio) {
+        assert(meter.type_of);
+        assert(low_watermark_ratio >= 0.0 && low_watermark_ratio <= 1.0);
+        meter_ = meter;
+        limits_ = limits;
+        low_watermark_ratio_ = low_watermark_ratio;
+        usage_.assign(limits_.size(), usage());
+        for (auto& t: queue_) account(t, true);
+    }
+
+    void set_watermark_cb(std::function<void(unsigned int type, bool high)> watermark_cb) {
+        watermark_cb_ = watermark_cb;
+    }
+
+    unsigned int get_type_size(unsigned int type) const {
+        return type < usage_.size() ? usage_[type].count : 0;
+    }
+
+    size_t get_type_bytes(unsigned int type) const {
+        return type < usage_.size() ? usage_[type].bytes : 0;
+    }
+
+    double get_type_duration(unsigned int type) const {
+        return type < usage_.size() ? usage_[type].duration : 0.0;
+    }
+
+    bool is_high(unsigned int type) const {
+        return type < usage_.size() && usage_[type].high;
+    }
+
     inline virtual void sort(std::function<bool(const T&, const T&)> compare) {
         std::sort(queue_.begin(), queue_.end(), compare);
     }
@@ -100,17 +180,115 @@ public:
             return false;
         }
         for (int i = 0; i < que.size(); i++) {
-            T t = que.at(i);
-            queue_.push_back(t);
+            queue_.push_back(std::move(que[i]));
         }
         std::sort(queue_.begin(), queue_.end(), compare);
         return true;
     }
 
+private:
+    class usage {
+    public:
+        unsigned int count = 0;
+        size_t bytes = 0;
+        double duration = 0.0;
+        bool high = false;
+    };
+
+    size_t bytes_of(const T& t) const {
+        return meter_.bytes_of ? meter_.bytes_of(t) : 0;
+    }
+
+    double duration_of(const T& t) const {
+        return meter_.duration_of ? meter_.duration_of(t) : 0.0;
+    }
+
+    bool exceeds(const ff_queue_limit& limit, const usage& u, double ratio) const {
+        return (limit.max_count && u.count > limit.max_count*ratio) ||
+               (limit.max_bytes && u.bytes > limit.max_bytes*ratio) ||
+               (limit.max_duration > 0.0 && u.duration > limit.max_duration*ratio);
+    }
+
+    bool reaches(const ff_queue_limit& limit, const usage& u) const {
+        return (limit.max_count && u.count >= limit.max_count) ||
+               (limit.max_bytes && u.bytes >= limit.max_bytes) ||
+               (limit.max_duration > 0.0 && u.duration >= limit.max_duration);
+    }
+
+    bool admits(const T& t) const {
+        if (!meter_.type_of) return true;
+        unsigned int type = meter_.type_of(t);
+        if (type >= usage_.size() || !usage_[type].count) return true;
+        usage u = usage_[type];
+        u.count++;
+        u.bytes += bytes_of(t);
+        u.duration += duration_of(t);
+        return !exceeds(limits_[type], u, 1.0);
+    }
+
+    template<typename InputIt>
+    bool admits(InputIt begin, InputIt end) const {
+        if (!meter_.type_of) return true;
+        std::vector<usage> usage = usage_;
+        for (; begin != end; ++begin) {
+            const T& t = *begin;
+            unsigned int type = meter_.type_of(t);
+            if (type >= usage.size()) continue;
+            usage[type].count++;
+            usage[type].bytes += bytes_of(t);
+            usage[type].duration += duration_of(t);
+        }
+        for (unsigned int type = 0; type < usage.size(); type++) {
+            if (usage_[type].count && exceeds(limits_[type], usage[type], 1.0)) return false;
+        }
+        return true;
+    }
+
+    void account(const T& t, bool add) {
+        if (!meter_.type_of) return;
+        unsigned int type = meter_.type_of(t);
+        if (type >= usage_.size()) return;
+        usage& u = usage_[type];
+        if (add) {
+            u.count++;
+            u.bytes += bytes_of(t);
+            u.duration += duration_of(t);
+            if (!u.high && reaches(limits_[type], u)) {
+                u.high = true;
+                if (watermark_cb_) watermark_cb_(type, true);
+            }
+        } else {
+            u.count--;
+            u.bytes -= std::min(u.bytes, bytes_of(t));
+            u.duration = std::max(0.0, u.duration-duration_of(t));
+            if (!u.count) {
+                u.bytes = 0;
+                u.duration = 0.0;
+            }
+            if (u.high && !exceeds(limits_[type], u, low_watermark_ratio_)) {
+                u.high = false;
+                if (watermark_cb_) watermark_cb_(type, false);
+            }
+        }
+    }
+
+    void clear_usage() {
+        for (unsigned int type = 0; type < usage_.size(); type++) {
+            bool high = usage_[type].high;
+            usage_[type] = usage();
+            if (high && watermark_cb_) watermark_cb_(type, false);
+        }
+    }
+
 private:
     ff_queue_base();
     unsigned int max_size_;
     std::deque<T> queue_;
+    ff_queue_meter<T> meter_;
+    std::vector<ff_queue_limit> limits_;
+    std::vector<usage> usage_;
+    double low_watermark_ratio_ = 1.0;
+    std::function<void(unsigned int, bool)> watermark_cb_ = nullptr;
 };
 
 template<typename T>
@@ -118,7 +296,8 @@ class ff_safe_queue: public ff_queue_base<T> {
 public:
     explicit ff_safe_queue(unsigned int max_size):
         ff_queue_base<T>(max_size),
-        canceled_(false) {}
+        canceled_(false),
+        interrupt_gen_(0) {}
 
     ~ff_safe_queue() {}
 
@@ -139,52 +318,115 @@ public:
 
     virtual bool enqueue(T&& t) override {
         std::unique_lock<std::mutex> lock(m_);
-        while(!canceled_.load() && !ff_queue_base<T>::enqueue(t)) {
+        unsigned int gen = interrupt_gen_;
+        while(!canceled_.load() && gen == interrupt_gen_ && !ff_queue_base<T>::enqueue(std::move(t))) {
             //std::cout << "safe queue enqueue in blocking: " << ff_queue_base<T>::get_size() << std::endl;
-            cv_.wait(lock);
+            wait_producer(lock);
         }
-        cv_.notify_all();
-        return !canceled_.load();
+        notify_consumers();
+        return !canceled_.load() && gen == interrupt_gen_;
     }
 
     virtual bool enqueue(T& t) override {
         std::unique_lock<std::mutex> lock(m_);
-        while(!canceled_.load() && !ff_queue_base<T>::enqueue(t)) {
+        unsigned int gen = interrupt_gen_;
+        while(!canceled_.load() && gen == interrupt_gen_ && !ff_queue_base<T>::enqueue(t)) {
             //std::cout << "safe queue enqueue in blocking: " << ff_queue_base<T>::get_size() << std::endl;
-            cv_.wait(lock);
+            wait_producer(lock);
         }
-        cv_.notify_all();
-        return !canceled_.load();
+        notify_consumers();
+        return !canceled_.load() && gen == interrupt_gen_;
     }
 
     virtual bool dequeue(T& t) override {
         std::unique_lock<std::mutex> lock(m_);
         while (!canceled_.load() && !ff_queue_base<T>::dequeue(t)) {
             //std::cout << "safe queue dequeue in blocking: " << ff_queue_base<T>::get_size() << std::endl;
-            cv_.wait(lock);
+            wait_consumer(lock);
         }
-        cv_.notify_all();
+        notify_producers();
         return !canceled_.load();
     }
 
+    bool try_enqueue(T&& t) {
+        std::unique_lock<std::mutex> lock(m_);
+        if (canceled_.load() || !ff_queue_base<T>::enqueue(std::move(t))) return false;
+        notify_consumers();
+        return true;
+    }
+
+    bool try_dequeue(T& t) {
+        std::unique_lock<std::mutex> lock(m_);
+        if (canceled_.load() || !ff_queue_base<T>::dequeue(t)) return false;
+        notify_producers();
+        return true;
+    }
+
+    template<typename InputIt>
+    bool enqueue_bulk(InputIt begin, InputIt end) {
+        std::unique_lock<std::mutex> lock(m_);
+        if ((size_t)std::distance(begin, end) > ff_queue_base<T>::get_max_size()) return false;
+        unsigned int gen = interrupt_gen_;
+        bool was_empty = ff_queue_base<T>::get_empty();
+        while (!canceled_.load() && gen == interrupt_gen_ && !ff_queue_base<T>::enqueue_bulk(begin, end)) {
+            wait_producer(lock);
+            was_empty = ff_queue_base<T>::get_empty();
+        }
+        if (canceled_.load() || gen != interrupt_gen_) return false;
+        if (was_empty) notify_consumers();
+        return true;
+    }
+
+    template<typename OutputIt>
+    unsigned int try_dequeue_bulk(OutputIt out, unsigned int max) {
+        std::unique_lock<std::mutex> lock(m_);
+        if (canceled_.load()) return 0;
+        unsigned int nb = ff_queue_base<T>::dequeue_bulk(out, max);
+        if (nb) notify_producers();
+        return nb;
+    }
+
+    template<typename Rep, typename Period>
+    bool dequeue_for(T& t, const std::chrono::duration<Rep, Period>& timeout) {
+        return dequeue_until(t, std::chrono::steady_clock::now()+timeout);
+    }
+
+    template<typename Clock, typename Duration>
+    bool dequeue_until(T& t, const std::chrono::time_point<Clock, Duration>& deadline) {
+        std::unique_lock<std::mutex> lock(m_);
+        while (!canceled_.load() && !ff_queue_base<T>::dequeue(t)) {
+            waiting_consumers_++;
+            std::cv_status status = cv_.wait_until(lock, deadline);
+            waiting_consumers_--;
+            if (status == std::cv_status::timeout) {
+                if (!ff_queue_base<T>::dequeue(t)) return false;
+                break;
+            }
+        }
+        if (canceled_.load()) return false;
+        notify_producers();
+        return true;
+    }
+
     inline virtual bool popqueue(T& t) {
         std::unique_lock<std::mutex> lock(m_);
         while (!canceled_.load() && !ff_queue_base<T>::popqueue(t)) {
             //std::cout << "safe queue popqueue in blocking: " << ff_queue_base<T>::get_size() << std::endl;
-            cv_.wait(lock);
+            wait_consumer(lock);
         }
-        cv_.notify_all();
+        notify_producers();
         return !canceled_.load();
     }
 
     virtual bool enpacket(std::deque<T>& que) override {
         std::unique_lock<std::mutex> lock(m_);
-        while (!canceled_.load() && !ff_queue_base<T>::enpacket(que)) {
+        unsigned int gen = interrupt_gen_;
+        while (!canceled_.load() && gen == interrupt_gen_ && !ff_queue_base<T>::enpacket(que)) {
             //std::cout << "safe queue enpacket in blocking: " << ff_queue_base<T>::get_size() << std::endl;
-            cv_.wait(lock);
+            wait_producer(lock);
         }
-        cv_.notify_all();
-        return !canceled_.load();
+        notify_consumers();
+        return !canceled_.load() && gen == interrupt_gen_;
     }
 
     inline bool is_canceled() {
@@ -192,12 +434,51 @@ public:
         return canceled_.load();
     }
 
+    void set_limits(const ff_queue_meter<T>& meter,
+                    const std::vector<ff_queue_limit>& limits,
+                    double low_watermark_ratio) {
+        std::unique_lock<std::mutex> lock(m_);
+        ff_queue_base<T>::set_limits(meter, limits, low_watermark_ratio);
+        cv_.notify_all();
+    }
+
+    void set_watermark_cb(std::function<void(unsigned int type, bool high)> watermark_cb) {
+        std::unique_lock<std::mutex> lock(m_);
+        ff_queue_base<T>::set_watermark_cb(watermark_cb);
+    }
+
+    unsigned int get_type_size(unsigned int type) {
+        std::unique_lock<std::mutex> lock(m_);
+        return ff_queue_base<T>::get_type_size(type);
+    }
+
+    size_t get_type_bytes(unsigned int type) {
+        std::unique_lock<std::mutex> lock(m_);
+        return ff_queue_base<T>::get_type_bytes(type);
+    }
+
+    double get_type_duration(unsigned int type) {
+        std::unique_lock<std::mutex> lock(m_);
+        return ff_queue_base<T>::get_type_duration(type);
+    }
+
+    bool is_high(unsigned int type) {
+        std::unique_lock<std::mutex> lock(m_);
+        return ff_queue_base<T>::is_high(type);
+    }
+
     void cancel() {
         std::unique_lock<std::mutex> lock(m_);
         canceled_.store(true);
         cv_.notify_all();
     }
 
+    void interrupt() {
+        std::unique_lock<std::mutex> lock(m_);
+        interrupt_gen_++;
+        cv_.notify_all();
+    }
+
     virtual void clear() override {
         std::unique_lock<std::mutex> lock(m_);
         ff_queue_base<T>::clear();
@@ -219,20 +500,46 @@ public:
     virtual bool enpacket_with_sort(std::deque<T>& que,
                                     std::function<bool(const T&, const T&)> compare) override {
         std::unique_lock<std::mutex> lock(m_);
-        while (!canceled_.load() && !ff_queue_base<T>::enpacket(que)) {
+        unsigned int gen = interrupt_gen_;
+        while (!canceled_.load() && gen == interrupt_gen_ && !ff_queue_base<T>::enpacket(que)) {
             //std::cout << "safe queue enpacket_with_sort in blocking: " <<\
                       ff_queue_base<T>::get_size() << std::endl;
-            cv_.wait(lock);
+            wait_producer(lock);
         }
+        if (gen != interrupt_gen_) return false;
         ff_queue_base<T>::sort(compare);
-        cv_.notify_all();
+        notify_consumers();
         return !canceled_.load();
     }
 
+private:
+    void wait_producer(std::unique_lock<std::mutex>& lock) {
+        waiting_producers_++;
+        cv_.wait(lock);
+        waiting_producers_--;
+    }
+
+    void wait_consumer(std::unique_lock<std::mutex>& lock) {
+        waiting_consumers_++;
+        cv_.wait(lock);
+        waiting_consumers_--;
+    }
+
+    void notify_producers() {
+        if (waiting_producers_) cv_.notify_all();
+    }
+
+    void notify_consumers() {
+        if (waiting_consumers_) cv_.notify_all();
+    }
+
 private:
     std::mutex m_;
     std::condition_variable cv_;
     std::atomic_bool canceled_;
+    unsigned int interrupt_gen_;
+    unsigned int waiting_producers_ = 0;
+    unsigned int waiting_consumers_ = 0;
 };
 }
 
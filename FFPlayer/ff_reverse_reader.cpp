@@ -0,0 +1 @@
+#include "ff_reverse_reader.h"
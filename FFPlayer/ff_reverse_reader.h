@@ -0,0 +1,124 @@
+#ifndef FF_REVERSE_READER_H
+#define FF_REVERSE_READER_H
+
+#include <assert.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include "ff_keyframe_decoder.h"
+#include "ff_queue_base.h"
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_reverse_reader {
+public:
+    class frame {
+    public:
+        double position = 0.0;
+        double duration = 0.0;
+        std::vector<uint8_t> picture;
+    };
+
+    class gop {
+    public:
+        std::deque<frame> frames;
+    };
+
+    ff_reverse_reader(const unsigned int dest_width,
+                      const unsigned int dest_height,
+                      const unsigned int depth = ff_decode_default_reverse_gop_depth,
+                      const unsigned int max_frames = ff_decode_default_reverse_gop_max_frames):
+        decoder_(dest_width, dest_height, AV_PIX_FMT_RGB24, false),
+        depth_(depth),
+        max_frames_(max_frames),
+        gops_(depth),
+        started_(false) {
+        assert(depth_);
+        assert(max_frames_);
+    }
+
+    ~ff_reverse_reader() {
+        interrupt();
+        join();
+    }
+
+    bool start(const char *file, double pos) {
+        assert(file);
+        interrupt();
+        join();
+        gops_.reset(depth_);
+        started_.store(true);
+        std::string path(file);
+        std::thread t([this, path, pos](){
+            ff_lower_thread_priority();
+            read(path, pos);
+            gops_.enqueue(std::shared_ptr<gop>());
+        });
+        thr_.swap(t);
+        return true;
+    }
+
+    bool next(std::shared_ptr<gop>& g) {
+        return gops_.dequeue(g) && g;
+    }
+
+    void interrupt() {
+        started_.store(false);
+        gops_.cancel();
+    }
+
+    void join() {
+        if (thr_.joinable() && thr_.get_id() != std::this_thread::get_id()) thr_.join();
+    }
+
+private:
+    void read(const std::string& path, double pos) {
+        if (decoder_.get_file() != path && !decoder_.open(path.c_str())) return;
+        double end = pos+decoder_.get_frame_duration()*0.5;
+        while (started_.load()) {
+            std::shared_ptr<gop> g = std::make_shared<gop>();
+            double target = end-decoder_.get_frame_duration()*0.5;
+            if (target < 0.0) target = 0.0;
+            if (!decoder_.decode_gop(target, [this, &g, end](double frame_pos,
+                                                              double frame_duration,
+                                                              std::vector<uint8_t>& picture){
+                if (frame_pos >= end) return;
+                frame f;
+                f.position = frame_pos;
+                f.duration = frame_duration;
+                f.picture.swap(picture);
+                auto it = std::upper_bound(g->frames.begin(), g->frames.end(), frame_pos,
+                                           [](double pos, const frame& f){return pos < f.position;});
+                g->frames.insert(it, std::move(f));
+                if (g->frames.size() > max_frames_) g->frames.pop_front();
+            }, [this](){return !started_.load();})) {
+                if (started_.load()) std::cout << "reverse reader decode failed at " << target << std::endl;
+                return;
+            }
+            if (g->frames.empty()) return;
+            end = g->frames.front().position;
+            if (!gops_.enqueue(g)) return;
+            if (end <= 0.0) return;
+        }
+    }
+
+private:
+    ff_reverse_reader();
+    ff_reverse_reader(const ff_reverse_reader&);
+    ff_reverse_reader& operator =(const ff_reverse_reader&);
+    ff_keyframe_decoder decoder_;
+    unsigned int depth_;
+    unsigned int max_frames_;
+    ff_safe_queue<std::shared_ptr<gop>> gops_;
+    std::atomic_bool started_;
+    std::thread thr_;
+};
+}
+
+#endif // FF_REVERSE_READER_H
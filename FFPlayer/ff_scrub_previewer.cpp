@@ -0,0 +1,2 @@
+#include "ff_scrub_previewer.h"
+
@@ -0,0 +1,117 @@
+#ifndef FF_SCRUB_PREVIEWER_H
+#define FF_SCRUB_PREVIEWER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include "ff_keyframe_decoder.h"
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_scrub_previewer {
+public:
+    typedef std::function<void(const uint8_t *picture,
+                               unsigned int width,
+                               unsigned int height,
+                               double position)> preview_cb;
+
+    ff_scrub_previewer(const unsigned int dest_width,
+                       const unsigned int dest_height):
+        decoder_(dest_width, dest_height),
+        started_(false),
+        pending_(false),
+        pos_(0.0),
+        gen_(0),
+        preview_cb_(nullptr) {}
+
+    ~ff_scrub_previewer() {stop();}
+
+    void start() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (started_.load()) return;
+        started_.store(true);
+        std::thread t([this](){
+            ff_lower_thread_priority();
+            std::vector<uint8_t> picture;
+            while (started_.load()) {
+                std::string file;
+                double pos = 0.0;
+                unsigned int gen = 0;
+                {
+                    std::unique_lock<std::mutex> lock(m_);
+                    while (started_.load() && !pending_) cv_.wait(lock);
+                    if (!started_.load()) break;
+                    file = file_;
+                    pos = pos_;
+                    gen = gen_.load();
+                    pending_ = false;
+                }
+                if (decoder_.get_file() != file && !decoder_.open(file.c_str())) continue;
+                double frame_pos = 0.0;
+                if (!decoder_.decode_at(pos, picture, frame_pos, [this, gen](){
+                    return gen != gen_.load() || !started_.load();
+                })) continue;
+                if (gen == gen_.load() && preview_cb_) {
+                    preview_cb_(picture.data(),
+                                decoder_.get_dest_width(),
+                                decoder_.get_dest_height(),
+                                frame_pos);
+                }
+            }
+            decoder_.close();
+        });
+        thr_.swap(t);
+    }
+
+    void request(const char *file, double pos) {
+        std::unique_lock<std::mutex> lock(m_);
+        file_ = file;
+        pos_ = pos;
+        pending_ = true;
+        gen_.fetch_add(1);
+        cv_.notify_all();
+    }
+
+    void cancel() {
+        std::unique_lock<std::mutex> lock(m_);
+        pending_ = false;
+        gen_.fetch_add(1);
+    }
+
+    void stop() {
+        {
+            std::unique_lock<std::mutex> lock(m_);
+            started_.store(false);
+            gen_.fetch_add(1);
+            cv_.notify_all();
+        }
+        if (thr_.joinable()) thr_.join();
+    }
+
+    void set_preview_cb(preview_cb cb) {
+        preview_cb_ = cb;
+    }
+
+private:
+    ff_scrub_previewer();
+    ff_scrub_previewer(const ff_scrub_previewer&);
+    ff_scrub_previewer& operator =(const ff_scrub_previewer&);
+    ff_keyframe_decoder decoder_;
+    std::thread thr_;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::atomic_bool started_;
+    bool pending_;
+    std::string file_;
+    double pos_;
+    std::atomic_uint gen_;
+    preview_cb preview_cb_;
+};
+}
+
+#endif // FF_SCRUB_PREVIEWER_H
@@ -0,0 +1,2 @@
+#include "ff_seek_channel.h"
+
@@ -0,0 +1,61 @@
+#ifndef FF_SEEK_CHANNEL_H
+#define FF_SEEK_CHANNEL_H
+
+#include <iostream>
+#include <mutex>
+#include <atomic>
+#include "ff_asyn_timer.h"
+
+namespace FFPlayer {
+class ff_seek_channel {
+public:
+    ff_seek_channel():
+        pending_(false),
+        position_(0.0),
+        timestamp_(0),
+        coalesced_(0) {}
+
+    ~ff_seek_channel() {}
+
+    void post(double position) {
+        std::unique_lock<std::mutex> lock(m_);
+        if (pending_.load()) coalesced_.fetch_add(1);
+        position_ = position;
+        timestamp_ = ff_asyn_timer::get_timestamp();
+        pending_.store(true);
+    }
+
+    bool take(double& position, unsigned long long& timestamp) {
+        std::unique_lock<std::mutex> lock(m_);
+        if (!pending_.load()) return false;
+        position = position_;
+        timestamp = timestamp_;
+        pending_.store(false);
+        return true;
+    }
+
+    inline bool pending() const {
+        return pending_.load();
+    }
+
+    void clear() {
+        std::unique_lock<std::mutex> lock(m_);
+        pending_.store(false);
+    }
+
+    unsigned long long get_coalesced() const {
+        return coalesced_.load();
+    }
+
+private:
+    ff_seek_channel(const ff_seek_channel&);
+    ff_seek_channel& operator =(const ff_seek_channel&);
+    std::mutex m_;
+    std::atomic_bool pending_;
+    double position_;
+    unsigned long long timestamp_;
+    std::atomic_ullong coalesced_;
+};
+}
+
+#endif // FF_SEEK_CHANNEL_H
@@ -1,6 +1,8 @@
 #ifndef FF_STREAM_BASE_H
 #define FF_STREAM_BASE_H
 
+#include <string.h>
+#include <stdlib.h>
 #include <iostream>
 #include <mutex>
 #include <condition_variable>
@@ -36,6 +38,18 @@ public:
         valid_len_ -= size;
         return true;
     }
+    inline virtual bool resize(unsigned int capacity, unsigned int diff) {
+        if (capacity == capacity_ && diff == diff_) return true;
+        T *stream = (T*)malloc(capacity);
+        if (!stream) return false;
+        free(stream_);
+        stream_ = stream;
+        capacity_ = capacity;
+        diff_ = diff;
+        pos_ = 0;
+        valid_len_ = 0;
+        return true;
+    }
     inline virtual bool clear(unsigned int size) {
         if (size > valid_len_) return false;
         valid_len_ -= size;
@@ -77,16 +91,52 @@ class ff_safe_stream: public ff_stream_base<T> {
 public:
     ff_safe_stream(unsigned int capacity, unsigned int diff):
         ff_stream_base<T>(capacity, diff),
-        canceled_(false) {}
+        canceled_(false),
+        high_watermark_(capacity),
+        low_watermark_(capacity),
+        throttled_(false) {}
     virtual bool append(T *data, unsigned int size) override {
         std::unique_lock<std::mutex> lock(m_);
-        while(!canceled_.load() && !ff_stream_base<T>::append(data, size)) {
+        while(!canceled_.load()) {
+            if (throttled_ && ff_stream_base<T>::valid_len() > low_watermark_) {
+                cv_.wait(lock);
+                continue;
+            }
+            throttled_ = false;
+            if (ff_stream_base<T>::valid_len()+size <= high_watermark_ &&
+                ff_stream_base<T>::append(data, size)) break;
             //std::cout << "safe stream append in blocking" << std::endl;
+            throttled_ = true;
             cv_.wait(lock);
         }
         cv_.notify_all();
         return !canceled_.load();
     }
+    virtual bool resize(unsigned int capacity, unsigned int diff) override {
+        std::unique_lock<std::mutex> lock(m_);
+        bool resized = ff_stream_base<T>::resize(capacity, diff);
+        high_watermark_ = ff_stream_base<T>::get_capacity();
+        low_watermark_ = high_watermark_;
+        throttled_ = false;
+        cv_.notify_all();
+        return resized;
+    }
+    void set_watermarks(unsigned int high, unsigned int low) {
+        std::unique_lock<std::mutex> lock(m_);
+        assert(low <= high);
+        high_watermark_ = high;
+        low_watermark_ = low;
+        throttled_ = false;
+        cv_.notify_all();
+    }
+    unsigned int get_high_watermark() {
+        std::unique_lock<std::mutex> lock(m_);
+        return high_watermark_;
+    }
+    unsigned int get_low_watermark() {
+        std::unique_lock<std::mutex> lock(m_);
+        return low_watermark_;
+    }
     virtual bool consume(T *data, unsigned int size) override {
         std::unique_lock<std::mutex> lock(m_);
         while(!canceled_.load() && !ff_stream_base<T>::consume(data, size)) {
@@ -104,6 +154,7 @@ public:
     virtual void clear_all() {
         std::unique_lock<std::mutex> lock(m_);
         ff_stream_base<T>::clear_all();
+        throttled_ = false;
         cv_.notify_all();
     }
     virtual T* data() override {
@@ -127,6 +178,7 @@ public:
         std::unique_lock<std::mutex> lock(m_);
         ff_stream_base<T>::reset();
         canceled_.store(false);
+        throttled_ = false;
         cv_.notify_all();
     }
     inline bool is_canceled() {
@@ -138,6 +190,9 @@ private:
     std::mutex m_;
     std::condition_variable cv_;
     std::atomic_bool canceled_;
+    unsigned int high_watermark_;
+    unsigned int low_watermark_;
+    bool throttled_;
 };
 }
 
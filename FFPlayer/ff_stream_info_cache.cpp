@@ -0,0 +1,6 @@
+#include "ff_stream_info_cache.h"
+
+namespace FFPlayer {
+constexpr const char *ff_stream_info_cache::suffix_;
+constexpr uint32_t ff_stream_info_cache::magic_;
+}
@@ -0,0 +1,135 @@
+#ifndef FF_STREAM_INFO_CACHE_H
+#define FF_STREAM_INFO_CACHE_H
+
+#include <assert.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+#include "ff_file_cache.h"
+
+namespace FFPlayer {
+class ff_stream_info_cache {
+public:
+    class stream_info {
+    public:
+        int32_t codec_type = AVMEDIA_TYPE_UNKNOWN;
+        int32_t codec_id = AV_CODEC_ID_NONE;
+        int32_t width = 0;
+        int32_t height = 0;
+        int32_t pix_fmt = AV_PIX_FMT_NONE;
+        int32_t sample_rate = 0;
+        int32_t channels = 0;
+        uint64_t channel_layout = 0;
+        int32_t sample_fmt = AV_SAMPLE_FMT_NONE;
+        AVRational time_base = {0, 1};
+        AVRational avg_frame_rate = {0, 1};
+        AVRational r_frame_rate = {0, 1};
+    };
+
+    explicit ff_stream_info_cache(const char *file):
+        file_(file),
+        duration_(AV_NOPTS_VALUE),
+        loaded_(false) {
+        assert(file_);
+    }
+
+    ~ff_stream_info_cache() {}
+
+    bool load() {
+        if (!fi_.load(file_)) return false;
+        std::ifstream ifs;
+        if (!ff_file_cache::open_for_read(fi_, suffix_, magic_, ifs)) return false;
+        uint32_t nb_streams = 0;
+        ifs.read((char *)&duration_, sizeof(duration_));
+        ifs.read((char *)&nb_streams, sizeof(nb_streams));
+        if (!ifs.good() || nb_streams > 64) return false;
+        streams_.resize(nb_streams);
+        ifs.read((char *)streams_.data(), nb_streams*sizeof(stream_info));
+        loaded_ = ifs.good();
+        return loaded_;
+    }
+
+    bool store(AVFormatContext *format_context) {
+        assert(format_context);
+        if (!fi_.load(file_)) return false;
+        duration_ = format_context->duration;
+        streams_.clear();
+        for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+            AVStream *st = format_context->streams[i];
+            AVCodecContext *cc = st->codec;
+            stream_info si;
+            si.codec_type = cc->codec_type;
+            si.codec_id = cc->codec_id;
+            si.width = cc->width;
+            si.height = cc->height;
+            si.pix_fmt = cc->pix_fmt;
+            si.sample_rate = cc->sample_rate;
+            si.channels = cc->channels;
+            si.channel_layout = cc->channel_layout;
+            si.sample_fmt = cc->sample_fmt;
+            si.time_base = st->time_base;
+            si.avg_frame_rate = st->avg_frame_rate;
+            si.r_frame_rate = st->r_frame_rate;
+            streams_.push_back(si);
+        }
+        std::ofstream ofs;
+        std::string temp_file;
+        if (!ff_file_cache::open_for_write(fi_, suffix_, magic_, ofs, temp_file)) return false;
+        uint32_t nb_streams = streams_.size();
+        ofs.write((const char *)&duration_, sizeof(duration_));
+        ofs.write((const char *)&nb_streams, sizeof(nb_streams));
+        ofs.write((const char *)streams_.data(), nb_streams*sizeof(stream_info));
+        loaded_ = ff_file_cache::close_for_write(fi_, suffix_, ofs, temp_file);
+        return loaded_;
+    }
+
+    bool apply(AVFormatContext *format_context) {
+        assert(format_context);
+        if (!loaded_ || streams_.size() != format_context->nb_streams) return false;
+        for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+            AVCodecContext *cc = format_context->streams[i]->codec;
+            if (cc->codec_type != streams_[i].codec_type ||
+                cc->codec_id != streams_[i].codec_id) return false;
+        }
+        for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+            AVStream *st = format_context->streams[i];
+            AVCodecContext *cc = st->codec;
+            const stream_info& si = streams_[i];
+            if (si.codec_type == AVMEDIA_TYPE_VIDEO) {
+                cc->width = si.width;
+                cc->height = si.height;
+                cc->pix_fmt = (enum AVPixelFormat)si.pix_fmt;
+            } else if (si.codec_type == AVMEDIA_TYPE_AUDIO) {
+                cc->sample_rate = si.sample_rate;
+                cc->channels = si.channels;
+                cc->channel_layout = si.channel_layout;
+                cc->sample_fmt = (enum AVSampleFormat)si.sample_fmt;
+            }
+            if (si.time_base.num && si.time_base.den) st->time_base = si.time_base;
+            st->avg_frame_rate = si.avg_frame_rate;
+            st->r_frame_rate = si.r_frame_rate;
+        }
+        if (format_context->duration == AV_NOPTS_VALUE) format_context->duration = duration_;
+        return true;
+    }
+
+    const ff_file_identity& get_file_identity() const {return fi_;}
+
+private:
+    ff_stream_info_cache();
+    ff_stream_info_cache(const ff_stream_info_cache&);
+    ff_stream_info_cache& operator =(const ff_stream_info_cache&);
+    static constexpr const char *suffix_ = "sinfo";
+    static constexpr uint32_t magic_ = 0x46465349;
+    const char *file_;
+    ff_file_identity fi_;
+    int64_t duration_;
+    std::vector<stream_info> streams_;
+    bool loaded_;
+};
+}
+
+#endif // FF_STREAM_INFO_CACHE_H
@@ -0,0 +1,5 @@
+#include "ff_thumbnail_engine.h"
+
+namespace FFPlayer {
+constexpr uint32_t ff_thumbnail_engine::magic_;
+}
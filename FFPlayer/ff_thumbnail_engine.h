@@ -0,0 +1,267 @@
+#ifndef FF_THUMBNAIL_ENGINE_H
+#define FF_THUMBNAIL_ENGINE_H
+
+#include <assert.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "ff_keyframe_decoder.h"
+#include "ff_queue_base.h"
+#include "ff_file_cache.h"
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_thumbnail_strip {
+public:
+    ff_thumbnail_strip():
+        width_(0),
+        height_(0),
+        count_(0),
+        positions_(NULL),
+        pictures_(NULL) {}
+
+    ~ff_thumbnail_strip() {}
+
+    bool map(const std::string& cache_file,
+             size_t data_offset,
+             unsigned int width,
+             unsigned int height,
+             unsigned int count) {
+        try {
+            fm_ = boost::interprocess::file_mapping(cache_file.c_str(), boost::interprocess::read_only);
+            region_ = boost::interprocess::mapped_region(fm_, boost::interprocess::read_only);
+        } catch (...) {
+            return false;
+        }
+        size_t picture_size = (size_t)width*height*3;
+        if (region_.get_size() < data_offset+count*(sizeof(double)+picture_size)) return false;
+        const uint8_t *data = (const uint8_t *)region_.get_address()+data_offset;
+        width_ = width;
+        height_ = height;
+        count_ = count;
+        positions_ = (const double *)data;
+        pictures_ = data+count*sizeof(double);
+        return true;
+    }
+
+    unsigned int get_width() const {return width_;}
+
+    unsigned int get_height() const {return height_;}
+
+    unsigned int get_count() const {return count_;}
+
+    double get_position(unsigned int i) const {
+        assert(i < count_);
+        return positions_[i];
+    }
+
+    const uint8_t *get_picture(unsigned int i) const {
+        assert(i < count_);
+        return pictures_+(size_t)i*width_*height_*3;
+    }
+
+    int nearest(double position) const {
+        if (!count_) return -1;
+        unsigned int best = 0;
+        for (unsigned int i = 1; i < count_; i++) {
+            if (std::abs(positions_[i]-position) < std::abs(positions_[best]-position)) best = i;
+        }
+        return best;
+    }
+
+private:
+    ff_thumbnail_strip(const ff_thumbnail_strip&);
+    ff_thumbnail_strip& operator =(const ff_thumbnail_strip&);
+    boost::interprocess::file_mapping fm_;
+    boost::interprocess::mapped_region region_;
+    unsigned int width_;
+    unsigned int height_;
+    unsigned int count_;
+    const double *positions_;
+    const uint8_t *pictures_;
+};
+
+class ff_thumbnail_engine {
+public:
+    typedef std::function<void(const std::string& file, bool generated)> generated_cb;
+
+    ff_thumbnail_engine(const unsigned int width,
+                        const unsigned int height,
+                        const unsigned int count,
+                        const unsigned int workers = std::max(1u, std::thread::hardware_concurrency()/2)):
+        width_(width),
+        height_(height),
+        count_(count),
+        workers_nb_(workers),
+        jobs_(ff_thumbnail_default_max_jobs),
+        started_(false),
+        generated_cb_(nullptr) {
+        assert(width_);
+        assert(height_);
+        assert(count_);
+        assert(workers_nb_);
+    }
+
+    ~ff_thumbnail_engine() {stop();}
+
+    void set_generated_cb(generated_cb cb) {
+        generated_cb_ = cb;
+    }
+
+    std::shared_ptr<ff_thumbnail_strip> load(const char *file) {
+        ff_file_identity fi;
+        if (!fi.load(file)) return nullptr;
+        std::ifstream ifs;
+        if (!ff_file_cache::open_for_read(fi, get_suffix().c_str(), magic_, ifs)) return nullptr;
+        uint32_t header[3] = {0};
+        ifs.read((char *)header, sizeof(header));
+        if (!ifs.good() || header[0] != width_ || header[1] != height_ || header[2] != count_) return nullptr;
+        size_t data_offset = align((size_t)ifs.tellg());
+        ifs.close();
+        std::shared_ptr<ff_thumbnail_strip> strip = std::make_shared<ff_thumbnail_strip>();
+        if (!strip->map(ff_file_cache::get_cache_file(fi, get_suffix().c_str()),
+                        data_offset,
+                        width_,
+                        height_,
+                        count_)) return nullptr;
+        return strip;
+    }
+
+    bool generate(const std::string& file) {
+        start();
+        std::unique_lock<std::mutex> lock(queued_m_);
+        if (queued_.count(file)) return true;
+        if (!jobs_.try_enqueue(std::string(file))) return false;
+        queued_.insert(file);
+        return true;
+    }
+
+    unsigned int generate_directory(const char *dir) {
+        boost::system::error_code ec;
+        unsigned int nb = 0;
+        boost::filesystem::recursive_directory_iterator it(dir, ec), end;
+        for (; !ec && it != end; it.increment(ec)) {
+            if (!boost::filesystem::is_regular_file(it->path(), ec)) continue;
+            std::string ext = it->path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if (ext == ".mp4" || ext == ".m4v" || ext == ".mov" || ext == ".mkv" ||
+                ext == ".avi" || ext == ".flv" || ext == ".ts" || ext == ".webm") {
+                if (generate(it->path().string())) nb++;
+            }
+        }
+        return nb;
+    }
+
+    bool generate_sync(const std::string& file, ff_keyframe_decoder& decoder) {
+        ff_file_identity fi;
+        if (!fi.load(file.c_str())) return false;
+        std::ifstream ifs;
+        if (ff_file_cache::open_for_read(fi, get_suffix().c_str(), magic_, ifs)) return true;
+        if (!decoder.open(file.c_str())) return false;
+        double duration = decoder.get_duration();
+        size_t picture_size = (size_t)width_*height_*3;
+        std::vector<double> positions(count_, 0.0);
+        std::vector<uint8_t> pictures(picture_size*count_, 0);
+        std::vector<uint8_t> picture;
+        for (unsigned int i = 0; i < count_ && started_.load(); i++) {
+            double frame_pos = duration*(i+0.5)/count_;
+            if (decoder.decode_at(frame_pos, picture, frame_pos, [this](){return !started_.load();}) &&
+                picture.size() == picture_size) {
+                memcpy(pictures.data()+i*picture_size, picture.data(), picture_size);
+            }
+            positions[i] = frame_pos;
+        }
+        decoder.close();
+        if (!started_.load()) return false;
+        std::ofstream ofs;
+        std::string temp_file;
+        if (!ff_file_cache::open_for_write(fi, get_suffix().c_str(), magic_, ofs, temp_file)) return false;
+        uint32_t header[3] = {width_, height_, count_};
+        ofs.write((const char *)header, sizeof(header));
+        size_t pos = (size_t)ofs.tellp();
+        std::vector<char> padding(align(pos)-pos, 0);
+        ofs.write(padding.data(), padding.size());
+        ofs.write((const char *)positions.data(), positions.size()*sizeof(double));
+        ofs.write((const char *)pictures.data(), pictures.size());
+        return ff_file_cache::close_for_write(fi, get_suffix().c_str(), ofs, temp_file);
+    }
+
+    void start() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (started_.load()) return;
+        started_.store(true);
+        jobs_.reset(ff_thumbnail_default_max_jobs);
+        for (unsigned int i = 0; i < workers_nb_; i++) {
+            workers_.push_back(std::thread([this](){
+                ff_lower_thread_priority();
+                ff_keyframe_decoder decoder(width_, height_);
+                std::string file;
+                while (started_.load() && jobs_.dequeue(file)) {
+                    bool generated = generate_sync(file, decoder);
+                    {
+                        std::unique_lock<std::mutex> lock(queued_m_);
+                        queued_.erase(file);
+                    }
+                    if (generated_cb_) generated_cb_(file, generated);
+                }
+            }));
+        }
+    }
+
+    void stop() {
+        std::unique_lock<std::mutex> lock(m_);
+        started_.store(false);
+        jobs_.cancel();
+        for (auto& worker: workers_) {
+            if (worker.joinable()) worker.join();
+        }
+        workers_.clear();
+        std::unique_lock<std::mutex> queued_lock(queued_m_);
+        queued_.clear();
+    }
+
+    unsigned int pending() {
+        return jobs_.get_size();
+    }
+
+private:
+    std::string get_suffix() const {
+        return std::string("thumbs_")+std::to_string(width_)+"x"+\
+                std::to_string(height_)+"x"+std::to_string(count_);
+    }
+
+    static size_t align(size_t pos) {
+        return (pos+15)&~(size_t)15;
+    }
+
+private:
+    ff_thumbnail_engine();
+    ff_thumbnail_engine(const ff_thumbnail_engine&);
+    ff_thumbnail_engine& operator =(const ff_thumbnail_engine&);
+    static constexpr uint32_t magic_ = 0x46465448;
+    uint32_t width_;
+    uint32_t height_;
+    uint32_t count_;
+    unsigned int workers_nb_;
+    ff_safe_queue<std::string> jobs_;
+    std::mutex m_;
+    std::mutex queued_m_;
+    std::set<std::string> queued_;
+    std::atomic_bool started_;
+    std::vector<std::thread> workers_;
+    generated_cb generated_cb_;
+};
+}
+
+#endif // FF_THUMBNAIL_ENGINE_H
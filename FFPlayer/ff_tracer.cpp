@@ -0,0 +1,9 @@
+#include "ff_tracer.h"
+
+namespace FFPlayer {
+std::atomic_bool ff_tracer::enabled_(ff_trace_default_enabled);
+std::mutex ff_tracer::buffers_m_;
+std::vector<std::shared_ptr<ff_tracer::buffer>> ff_tracer::buffers_;
+thread_local ff_tracer::buffer *ff_tracer::thread_buffer_ = nullptr;
+thread_local const char *ff_tracer::thread_name_ = nullptr;
+}
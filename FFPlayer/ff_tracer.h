@@ -0,0 +1,190 @@
+#ifndef FF_TRACER_H
+#define FF_TRACER_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_tracer {
+public:
+    class event {
+    public:
+        const char *name;
+        char phase;
+        double timestamp;
+        double pts;
+    };
+
+    static bool enabled() {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    static void set_enabled(bool enabled) {
+        enabled_.store(enabled);
+    }
+
+    static void set_thread_name(const char *name) {
+        thread_name_ = name;
+        if (thread_buffer_) thread_buffer_->name.store(name, std::memory_order_relaxed);
+    }
+
+    static void begin(const char *name, double pts = NAN) {
+        emit(name, 'B', pts);
+    }
+
+    static void end(const char *name) {
+        emit(name, 'E', NAN);
+    }
+
+    static void instant(const char *name, double pts = NAN) {
+        emit(name, 'i', pts);
+    }
+
+    static bool clear() {
+        std::unique_lock<std::mutex> lock(buffers_m_);
+        if (enabled_.load()) return false;
+        for (auto& buffer: buffers_) {
+            while (buffer->busy.load()) std::this_thread::yield();
+            buffer->size.store(0, std::memory_order_release);
+            buffer->dropped.store(0, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    static unsigned long long get_dropped() {
+        std::unique_lock<std::mutex> lock(buffers_m_);
+        unsigned long long dropped = 0;
+        for (auto& buffer: buffers_) dropped += buffer->dropped.load(std::memory_order_relaxed);
+        return dropped;
+    }
+
+    static bool export_json(std::ostream& os) {
+        std::unique_lock<std::mutex> lock(buffers_m_);
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (auto& buffer: buffers_) {
+            if (!first) os << ",";
+            first = false;
+            const char *name = buffer->name.load(std::memory_order_relaxed);
+            os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+               << ",\"args\":{\"name\":\"" << (name ? name : "thread") << "\"}}";
+            size_t size = buffer->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < size; i++) {
+                const event& e = buffer->events[i];
+                os << ",{\"name\":\"" << e.name
+                   << "\",\"ph\":\"" << e.phase
+                   << "\",\"pid\":1,\"tid\":" << buffer->tid
+                   << ",\"ts\":" << std::fixed << e.timestamp;
+                os.unsetf(std::ios::floatfield);
+                if (e.phase == 'i') os << ",\"s\":\"t\"";
+                if (!std::isnan(e.pts)) os << ",\"args\":{\"pts\":" << e.pts << "}";
+                os << "}";
+            }
+        }
+        os << "]}";
+        return os.good();
+    }
+
+    static bool export_json(const char *file) {
+        std::ofstream ofs(file, std::ios::trunc);
+        if (!ofs.is_open()) {
+            std::cout << "trace export failed: " << file << std::endl;
+            return false;
+        }
+        return export_json(ofs);
+    }
+
+private:
+    class buffer {
+    public:
+        explicit buffer(unsigned int tid, size_t capacity):
+            tid(tid),
+            name(nullptr),
+            events(capacity),
+            size(0),
+            dropped(0),
+            busy(false) {}
+        unsigned int tid;
+        std::atomic<const char *> name;
+        std::vector<event> events;
+        std::atomic<size_t> size;
+        std::atomic_ullong dropped;
+        std::atomic_bool busy;
+    };
+
+    static void emit(const char *name, char phase, double pts) {
+        if (!enabled()) return;
+        buffer *b = thread_buffer_ ? thread_buffer_ : register_thread();
+        b->busy.store(true);
+        if (!enabled_.load()) {
+            b->busy.store(false);
+            return;
+        }
+        emit(b, name, phase, pts);
+        b->busy.store(false);
+    }
+
+    static void emit(buffer *b, const char *name, char phase, double pts) {
+        size_t size = b->size.load(std::memory_order_relaxed);
+        if (size >= b->events.size()) {
+            b->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        event& e = b->events[size];
+        e.name = name;
+        e.phase = phase;
+        e.timestamp = now();
+        e.pts = pts;
+        b->size.store(size+1, std::memory_order_release);
+    }
+
+    static buffer *register_thread() {
+        std::unique_lock<std::mutex> lock(buffers_m_);
+        std::shared_ptr<buffer> b = std::make_shared<buffer>(buffers_.size()+1, ff_trace_default_buffer_events);
+        b->name.store(thread_name_, std::memory_order_relaxed);
+        buffers_.push_back(b);
+        thread_buffer_ = b.get();
+        return thread_buffer_;
+    }
+
+    static double now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>\
+                (std::chrono::steady_clock::now().time_since_epoch()).count()/1000.0;
+    }
+
+private:
+    static std::atomic_bool enabled_;
+    static std::mutex buffers_m_;
+    static std::vector<std::shared_ptr<buffer>> buffers_;
+    static thread_local buffer *thread_buffer_;
+    static thread_local const char *thread_name_;
+};
+
+class ff_trace_scope {
+public:
+    explicit ff_trace_scope(const char *name, double pts = NAN):
+        name_(ff_tracer::enabled() ? name : nullptr) {
+        if (name_) ff_tracer::begin(name_, pts);
+    }
+
+    ~ff_trace_scope() {
+        if (name_) ff_tracer::end(name_);
+    }
+
+private:
+    ff_trace_scope(const ff_trace_scope&);
+    ff_trace_scope& operator =(const ff_trace_scope&);
+    const char *name_;
+};
+}
+
+#endif // FF_TRACER_H
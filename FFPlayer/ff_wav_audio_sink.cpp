@@ -0,0 +1 @@
+#include "ff_wav_audio_sink.h"
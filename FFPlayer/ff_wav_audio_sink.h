@@ -0,0 +1,122 @@
+#ifndef FF_WAV_AUDIO_SINK_H
+#define FF_WAV_AUDIO_SINK_H
+
+#include <assert.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+#include "ff_audio_sink.h"
+
+namespace FFPlayer {
+class ff_wav_audio_sink: public ff_audio_sink {
+public:
+    explicit ff_wav_audio_sink(const char *file):
+        file_(file),
+        data_bytes_(0),
+        started_(false) {
+        assert(file);
+    }
+
+    ~ff_wav_audio_sink() {
+        stop();
+        close();
+    }
+
+    virtual bool prepare() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (ofs_.is_open()) return true;
+        if (!get_frame_bytes() || sample_rate_ <= 0.0) return false;
+        ofs_.open(file_, std::ios::binary | std::ios::trunc);
+        if (!ofs_.is_open()) {
+            std::cout << "wav sink open failed: " << file_ << std::endl;
+            return false;
+        }
+        data_bytes_ = 0;
+        return write_header();
+    }
+
+    virtual bool start() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (!ofs_.is_open()) return false;
+        started_.store(true);
+        return true;
+    }
+
+    virtual bool is_started() const override {
+        return started_.load();
+    }
+
+    virtual bool stop() override {
+        started_.store(false);
+        return true;
+    }
+
+    virtual bool close() override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (!ofs_.is_open()) return true;
+        ofs_.seekp(0);
+        bool ok = write_header();
+        ofs_.close();
+        return ok;
+    }
+
+    virtual bool write(const void *data, size_t size) override {
+        std::unique_lock<std::mutex> lock(m_);
+        if (!ofs_.is_open()) return false;
+        ofs_.write((const char *)data, size);
+        data_bytes_ += size;
+        return ofs_.good();
+    }
+
+    virtual size_t write_available() const override {
+        return std::numeric_limits<size_t>::max();
+    }
+
+    unsigned long long get_data_bytes() {
+        std::unique_lock<std::mutex> lock(m_);
+        return data_bytes_;
+    }
+
+private:
+    bool write_header() {
+        uint16_t format = sample_format_ == paFloat32 ? 3 : 1;
+        uint16_t channels = channel_nb_;
+        uint32_t sample_rate = sample_rate_;
+        uint16_t block_align = get_frame_bytes();
+        uint32_t byte_rate = sample_rate*block_align;
+        uint16_t bits = block_align/channels*8;
+        uint32_t data_bytes = std::min<unsigned long long>(data_bytes_, std::numeric_limits<uint32_t>::max()-36);
+        uint32_t riff_bytes = 36+data_bytes;
+        uint32_t fmt_bytes = 16;
+        ofs_.write("RIFF", 4);
+        ofs_.write((const char *)&riff_bytes, 4);
+        ofs_.write("WAVEfmt ", 8);
+        ofs_.write((const char *)&fmt_bytes, 4);
+        ofs_.write((const char *)&format, 2);
+        ofs_.write((const char *)&channels, 2);
+        ofs_.write((const char *)&sample_rate, 4);
+        ofs_.write((const char *)&byte_rate, 4);
+        ofs_.write((const char *)&block_align, 2);
+        ofs_.write((const char *)&bits, 2);
+        ofs_.write("data", 4);
+        ofs_.write((const char *)&data_bytes, 4);
+        return ofs_.good();
+    }
+
+private:
+    ff_wav_audio_sink();
+    ff_wav_audio_sink(const ff_wav_audio_sink&);
+    ff_wav_audio_sink& operator =(const ff_wav_audio_sink&);
+    std::mutex m_;
+    std::string file_;
+    std::ofstream ofs_;
+    unsigned long long data_bytes_;
+    std::atomic_bool started_;
+};
+}
+
+#endif // FF_WAV_AUDIO_SINK_H
@@ -0,0 +1,5 @@
+#include "ff_waveform_analyzer.h"
+
+namespace FFPlayer {
+constexpr uint32_t ff_waveform_analyzer::magic_;
+}
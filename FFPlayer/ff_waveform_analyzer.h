@@ -0,0 +1,324 @@
+#ifndef FF_WAVEFORM_ANALYZER_H
+#define FF_WAVEFORM_ANALYZER_H
+
+#include <assert.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
+}
+#include "ff_audio_mixer.h"
+#include "ff_queue_base.h"
+#include "ff_file_cache.h"
+#include "ff_confi.h"
+
+namespace FFPlayer {
+class ff_waveform {
+public:
+    ff_waveform():
+        duration_(0.0) {}
+
+    explicit ff_waveform(unsigned int bucket_nb):
+        duration_(0.0),
+        min_(bucket_nb, 0),
+        max_(bucket_nb, 0),
+        rms_(bucket_nb, 0) {}
+
+    unsigned int get_bucket_nb() const {return min_.size();}
+
+    double get_duration() const {return duration_;}
+
+    float get_min(unsigned int i) const {return to_float(min_.at(i));}
+
+    float get_max(unsigned int i) const {return to_float(max_.at(i));}
+
+    float get_rms(unsigned int i) const {return to_float(rms_.at(i));}
+
+    int bucket_at(double position) const {
+        if (min_.empty() || duration_ <= 0.0) return -1;
+        int i = (int)(position/duration_*min_.size());
+        return std::max(0, std::min<int>(i, min_.size()-1));
+    }
+
+    void set(unsigned int i, float min, float max, float rms) {
+        min_.at(i) = to_int16(min);
+        max_.at(i) = to_int16(max);
+        rms_.at(i) = to_int16(rms);
+    }
+
+    void set_duration(double duration) {
+        duration_ = duration;
+    }
+
+    bool write(std::ostream& os) const {
+        uint32_t bucket_nb = min_.size();
+        os.write((const char *)&bucket_nb, sizeof(bucket_nb));
+        os.write((const char *)&duration_, sizeof(duration_));
+        os.write((const char *)min_.data(), bucket_nb*sizeof(int16_t));
+        os.write((const char *)max_.data(), bucket_nb*sizeof(int16_t));
+        os.write((const char *)rms_.data(), bucket_nb*sizeof(int16_t));
+        return os.good();
+    }
+
+    bool read(std::istream& is, unsigned int expected_bucket_nb) {
+        uint32_t bucket_nb = 0;
+        is.read((char *)&bucket_nb, sizeof(bucket_nb));
+        if (!is.good() || bucket_nb != expected_bucket_nb) return false;
+        is.read((char *)&duration_, sizeof(duration_));
+        min_.resize(bucket_nb);
+        max_.resize(bucket_nb);
+        rms_.resize(bucket_nb);
+        is.read((char *)min_.data(), bucket_nb*sizeof(int16_t));
+        is.read((char *)max_.data(), bucket_nb*sizeof(int16_t));
+        is.read((char *)rms_.data(), bucket_nb*sizeof(int16_t));
+        return is.good();
+    }
+
+private:
+    static int16_t to_int16(float v) {
+        return (int16_t)std::lrint(std::max(-1.0f, std::min(1.0f, v))*32767.0f);
+    }
+
+    static float to_float(int16_t v) {
+        return v/32767.0f;
+    }
+
+private:
+    double duration_;
+    std::vector<int16_t> min_;
+    std::vector<int16_t> max_;
+    std::vector<int16_t> rms_;
+};
+
+class ff_waveform_analyzer {
+public:
+    typedef std::function<void(const std::string& file, bool analyzed)> analyzed_cb;
+
+    explicit ff_waveform_analyzer(const unsigned int bucket_nb = ff_waveform_default_buckets):
+        bucket_nb_(bucket_nb),
+        jobs_(ff_waveform_default_max_jobs),
+        started_(false),
+        analyzed_cb_(nullptr) {
+        assert(bucket_nb_);
+    }
+
+    ~ff_waveform_analyzer() {stop();}
+
+    void set_analyzed_cb(analyzed_cb cb) {
+        analyzed_cb_ = cb;
+    }
+
+    std::shared_ptr<ff_waveform> load(const char *file) {
+        ff_file_identity fi;
+        if (!fi.load(file)) return nullptr;
+        std::ifstream ifs;
+        if (!ff_file_cache::open_for_read(fi, get_suffix().c_str(), magic_, ifs)) return nullptr;
+        std::shared_ptr<ff_waveform> waveform = std::make_shared<ff_waveform>();
+        if (!waveform->read(ifs, bucket_nb_)) return nullptr;
+        return waveform;
+    }
+
+    bool analyze(const std::string& file) {
+        start();
+        std::unique_lock<std::mutex> lock(queued_m_);
+        if (queued_.count(file)) return true;
+        if (!jobs_.try_enqueue(std::string(file))) return false;
+        queued_.insert(file);
+        return true;
+    }
+
+    bool analyze_sync(const std::string& file) {
+        ff_file_identity fi;
+        if (!fi.load(file.c_str())) return false;
+        std::ifstream ifs;
+        if (ff_file_cache::open_for_read(fi, get_suffix().c_str(), magic_, ifs)) return true;
+        ff_waveform waveform(bucket_nb_);
+        if (!decode(file.c_str(), waveform)) return false;
+        std::ofstream ofs;
+        std::string temp_file;
+        if (!ff_file_cache::open_for_write(fi, get_suffix().c_str(), magic_, ofs, temp_file)) return false;
+        waveform.write(ofs);
+        return ff_file_cache::close_for_write(fi, get_suffix().c_str(), ofs, temp_file);
+    }
+
+    void start() {
+        std::unique_lock<std::mutex> lock(m_);
+        if (started_.load()) return;
+        started_.store(true);
+        jobs_.reset(ff_waveform_default_max_jobs);
+        std::thread t([this](){
+            ff_lower_thread_priority();
+            std::string file;
+            while (started_.load() && jobs_.dequeue(file)) {
+                bool analyzed = analyze_sync(file);
+                {
+                    std::unique_lock<std::mutex> lock(queued_m_);
+                    queued_.erase(file);
+                }
+                if (analyzed_cb_) analyzed_cb_(file, analyzed);
+            }
+        });
+        worker_.swap(t);
+    }
+
+    void stop() {
+        std::unique_lock<std::mutex> lock(m_);
+        started_.store(false);
+        jobs_.cancel();
+        if (worker_.joinable()) worker_.join();
+        std::unique_lock<std::mutex> queued_lock(queued_m_);
+        queued_.clear();
+    }
+
+    unsigned int pending() {
+        return jobs_.get_size();
+    }
+
+private:
+    class bucket {
+    public:
+        float min = std::numeric_limits<float>::max();
+        float max = std::numeric_limits<float>::lowest();
+        double sum_sq = 0.0;
+        uint64_t samples = 0;
+    };
+
+    bool decode(const char *file, ff_waveform& waveform) {
+        ff_register_all();
+        AVFormatContext *format_context = avformat_alloc_context();
+        AVDictionary *format_opts = NULL;
+        av_dict_set_int(&format_opts, "probesize", ff_decode_default_probe_size, 0);
+        av_dict_set_int(&format_opts, "analyzeduration", ff_decode_default_analyze_duration, 0);
+        int err = avformat_open_input(&format_context, file, NULL, &format_opts);
+        av_dict_free(&format_opts);
+        if (err) return false;
+        AVCodecContext *codec_context = NULL;
+        SwrContext *swr_context = NULL;
+        AVFrame *frame = av_frame_alloc();
+        uint8_t *samples = NULL;
+        unsigned int samples_size = 0;
+        bool ok = false;
+        do {
+            int audio_stream = av_find_best_stream(format_context, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+            if (audio_stream < 0 || !frame) break;
+            for (unsigned int i = 0; i < format_context->nb_streams; i++) {
+                if ((int)i != audio_stream) format_context->streams[i]->discard = AVDISCARD_ALL;
+            }
+            AVStream *st = format_context->streams[audio_stream];
+            double duration = format_context->duration == AV_NOPTS_VALUE ? 0.0 :
+                              (double)format_context->duration/(double)AV_TIME_BASE;
+            if (duration <= 0.0) break;
+            AVCodec *codec = avcodec_find_decoder(st->codec->codec_id);
+            if (!codec) break;
+            codec_context = avcodec_alloc_context3(codec);
+            if (!codec_context || avcodec_copy_context(codec_context, st->codec) < 0) break;
+            if (avcodec_open2(codec_context, codec, NULL) < 0) break;
+            uint64_t in_ch_layout = codec_context->channel_layout ? codec_context->channel_layout :
+                                    av_get_default_channel_layout(codec_context->channels);
+            swr_context = swr_alloc_set_opts(NULL,
+                                             AV_CH_LAYOUT_MONO,
+                                             AV_SAMPLE_FMT_FLT,
+                                             codec_context->sample_rate,
+                                             in_ch_layout,
+                                             codec_context->sample_fmt,
+                                             codec_context->sample_rate,
+                                             0,
+                                             NULL);
+            if (!swr_context || swr_init(swr_context) < 0) break;
+            double bucket_samples = std::max(1.0, duration*codec_context->sample_rate/bucket_nb_);
+            std::vector<bucket> buckets(bucket_nb_);
+            uint64_t sample_index = 0;
+            AVPacket packet;
+            av_init_packet(&packet);
+            while (started_.load() && av_read_frame(format_context, &packet) >= 0) {
+                if (packet.stream_index == audio_stream) {
+                    AVPacket pkt = packet;
+                    while (pkt.size > 0) {
+                        int got_frame = 0;
+                        int len = avcodec_decode_audio4(codec_context, frame, &got_frame, &pkt);
+                        if (len < 0) break;
+                        pkt.data += len;
+                        pkt.size -= len;
+                        if (!got_frame) continue;
+                        int out_samples = swr_get_out_samples(swr_context, frame->nb_samples);
+                        if (out_samples <= 0) continue;
+                        av_fast_malloc(&samples, &samples_size, out_samples*sizeof(float));
+                        if (!samples) break;
+                        out_samples = swr_convert(swr_context,
+                                                  &samples,
+                                                  out_samples,
+                                                  (const uint8_t **)frame->extended_data,
+                                                  frame->nb_samples);
+                        if (out_samples > 0) accumulate((const float *)samples, out_samples, bucket_samples, sample_index, buckets);
+                    }
+                }
+                av_free_packet(&packet);
+            }
+            if (!started_.load()) break;
+            for (unsigned int i = 0; i < bucket_nb_; i++) {
+                const bucket& b = buckets[i];
+                if (!b.samples) continue;
+                waveform.set(i, b.min, b.max, (float)std::sqrt(b.sum_sq/b.samples));
+            }
+            waveform.set_duration(duration);
+            ok = true;
+        } while (false);
+        av_freep(&samples);
+        if (swr_context) swr_free(&swr_context);
+        if (frame) av_frame_free(&frame);
+        if (codec_context) avcodec_free_context(&codec_context);
+        avformat_close_input(&format_context);
+        return ok;
+    }
+
+    void accumulate(const float *samples,
+                    int nb,
+                    double bucket_samples,
+                    uint64_t& sample_index,
+                    std::vector<bucket>& buckets) {
+        while (nb > 0) {
+            unsigned int i = std::min<uint64_t>(sample_index/bucket_samples, bucket_nb_-1);
+            uint64_t bucket_end = i+1 < bucket_nb_ ? (uint64_t)std::ceil((i+1)*bucket_samples) :
+                                                     std::numeric_limits<uint64_t>::max();
+            int chunk = (int)std::min<uint64_t>(nb, std::max<uint64_t>(1, bucket_end-sample_index));
+            bucket& b = buckets[i];
+            ff_audio_mixer::peaks_f32(samples, chunk, b.min, b.max, b.sum_sq);
+            b.samples += chunk;
+            samples += chunk;
+            nb -= chunk;
+            sample_index += chunk;
+        }
+    }
+
+    std::string get_suffix() const {
+        return std::string("waveform_")+std::to_string(bucket_nb_);
+    }
+
+private:
+    ff_waveform_analyzer(const ff_waveform_analyzer&);
+    ff_waveform_analyzer& operator =(const ff_waveform_analyzer&);
+    static constexpr uint32_t magic_ = 0x46465746;
+    unsigned int bucket_nb_;
+    ff_safe_queue<std::string> jobs_;
+    std::mutex m_;
+    std::mutex queued_m_;
+    std::set<std::string> queued_;
+    std::atomic_bool started_;
+    std::thread worker_;
+    analyzed_cb analyzed_cb_;
+};
+}
+
+#endif // FF_WAVEFORM_ANALYZER_H
@@ -5,6 +5,8 @@
 #include <iostream>
 #include <mp4v2/mp4v2.h>
 #include <stdarg.h>
+#include <vector>
+#include <utility>
 
 namespace FFPlayer {
 class mp4_helper {
@@ -56,7 +58,29 @@ public:
     bool optimize() {
         return MP4Optimize(file_);
     }
-    ~mp4_helper(){}
+    bool is_valid() const {
+        return mfh_ != MP4_INVALID_FILE_HANDLE;
+    }
+    bool get_video_sync_samples(std::vector<std::pair<double, uint64_t>>& samples) {
+        if (!is_valid()) return false;
+        MP4TrackId tid = MP4FindTrackId(mfh_, 0, MP4_VIDEO_TRACK_TYPE);
+        if (tid == MP4_INVALID_TRACK_ID) return false;
+        uint32_t ts = MP4GetTrackTimeScale(mfh_, tid);
+        uint32_t nb_samples = MP4GetTrackNumberOfSamples(mfh_, tid);
+        if (!ts || !nb_samples) return false;
+        samples.clear();
+        for (MP4SampleId sid = 1; sid <= nb_samples; sid++) {
+            if (MP4GetSampleSync(mfh_, tid, sid) != 1) continue;
+            MP4Timestamp dts = MP4GetSampleTime(mfh_, tid, sid);
+            MP4Duration offset = MP4GetSampleRenderingOffset(mfh_, tid, sid);
+            samples.push_back(std::make_pair((double)(dts+offset)/(double)ts,
+                                             MP4GetSampleFileOffset(mfh_, tid, sid)));
+        }
+        return !samples.empty();
+    }
+    ~mp4_helper(){
+        if (is_valid()) MP4Close(mfh_, 0);
+    }
 private:
     const char *file_;
     MP4FileHandle mfh_;
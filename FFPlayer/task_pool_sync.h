@@ -22,7 +22,12 @@ public:
             std::thread t([this](){
                 std::function<void(void)> task;
                 while(started_.load()) {
-                    if (queue_.dequeue(task)) task();
+                    bool dequeued = false;
+                    {
+                        std::unique_lock<std::mutex> lock(m_);
+                        dequeued = queue_.dequeue(task);
+                    }
+                    if (dequeued) task();
                     std::this_thread::sleep_for(std::chrono::microseconds(5));
                 }
                 if (closing_cb_) closing_cb_(this);
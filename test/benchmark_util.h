@@ -0,0 +1,60 @@
+#ifndef BENCHMARK_UTIL_H
+#define BENCHMARK_UTIL_H
+
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include "ff_latency_histogram.h"
+
+namespace FFPlayer {
+class benchmark_util {
+public:
+    static unsigned long long now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>\
+                (std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static double get_scale(int argc, char *argv[]) {
+        double scale = argc > 1 ? atof(argv[1]) : 1.0;
+        return scale > 0.0 ? scale : 1.0;
+    }
+
+    static unsigned int scaled(unsigned int nb, double scale) {
+        return std::max(1u, (unsigned int)(nb*scale));
+    }
+
+    static void wait_for(const std::atomic_bool& flag) {
+        while (!flag.load()) std::this_thread::yield();
+    }
+
+    static void print_header(const char *unit) {
+        std::cout << std::left << std::setw(40) << "case" << std::right
+                  << std::setw(16) << unit
+                  << std::setw(10) << "p50"
+                  << std::setw(10) << "p90"
+                  << std::setw(10) << "p99"
+                  << std::setw(10) << "p999"
+                  << std::setw(12) << "max" << std::endl;
+    }
+
+    static void print_row(const std::string& name, double rate, const ff_latency_histogram *latency = nullptr) {
+        std::cout << std::left << std::setw(40) << name << std::right
+                  << std::setw(16) << std::fixed << std::setprecision(1) << rate;
+        if (latency) {
+            ff_latency_summary s = latency->summarize();
+            std::cout << std::setw(10) << s.p50
+                      << std::setw(10) << s.p90
+                      << std::setw(10) << s.p99
+                      << std::setw(10) << s.p999
+                      << std::setw(12) << s.max;
+        }
+        std::cout << std::endl;
+    }
+};
+}
+
+#endif // BENCHMARK_UTIL_H
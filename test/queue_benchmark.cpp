@@ -0,0 +1,130 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <iterator>
+#include "ff_queue_base.h"
+#include "benchmark_util.h"
+
+using namespace FFPlayer;
+
+static const unsigned int queue_size = 256;
+
+class item {
+public:
+    unsigned long long timestamp = 0;
+    std::shared_ptr<int> payload;
+};
+
+static double run_single_thread_base(unsigned int total_items) {
+    ff_queue_base<item> queue(queue_size);
+    item in, out;
+    in.payload = std::make_shared<int>(0);
+    unsigned long long begin = benchmark_util::now_ns();
+    for (unsigned int i = 0; i < total_items; i++) {
+        queue.enqueue(in);
+        queue.dequeue(out);
+    }
+    return total_items/((benchmark_util::now_ns()-begin)/1e9);
+}
+
+static double run_single_thread_safe(unsigned int total_items) {
+    ff_safe_queue<item> queue(queue_size);
+    item in, out;
+    in.payload = std::make_shared<int>(0);
+    unsigned long long begin = benchmark_util::now_ns();
+    for (unsigned int i = 0; i < total_items; i++) {
+        queue.enqueue(in);
+        queue.try_dequeue(out);
+    }
+    return total_items/((benchmark_util::now_ns()-begin)/1e9);
+}
+
+static double run_contended(unsigned int producer_nb, unsigned int total_items, ff_latency_histogram& latency) {
+    ff_safe_queue<item> queue(queue_size);
+    unsigned int per_producer = total_items/producer_nb;
+    total_items = per_producer*producer_nb;
+    unsigned long long begin = benchmark_util::now_ns();
+    std::vector<std::thread> producers;
+    for (unsigned int p = 0; p < producer_nb; p++) {
+        producers.emplace_back([&queue, per_producer](){
+            for (unsigned int i = 0; i < per_producer; i++) {
+                item in;
+                in.payload = std::make_shared<int>(i);
+                in.timestamp = benchmark_util::now_ns();
+                if (!queue.enqueue(in)) break;
+            }
+        });
+    }
+    unsigned int received = 0;
+    while (received < total_items) {
+        item out;
+        if (!queue.dequeue_for(out, std::chrono::milliseconds(100))) continue;
+        latency.record(benchmark_util::now_ns()-out.timestamp);
+        received++;
+    }
+    for (auto& t: producers) t.join();
+    return total_items/((benchmark_util::now_ns()-begin)/1e9);
+}
+
+static double run_batched(unsigned int batch, unsigned int total_items) {
+    ff_safe_queue<std::shared_ptr<int>> queue(queue_size);
+    auto begin = std::chrono::steady_clock::now();
+    std::thread producer([&queue, batch, total_items](){
+        std::vector<std::shared_ptr<int>> items;
+        items.reserve(batch);
+        for (unsigned int i = 0; i < total_items; i += batch) {
+            items.clear();
+            for (unsigned int j = 0; j < batch && i+j < total_items; j++)
+                items.push_back(std::make_shared<int>(i+j));
+            if (batch == 1) {
+                queue.enqueue(items[0]);
+            } else if (!queue.enqueue_bulk(items.begin(), items.end())) {
+                break;
+            }
+        }
+    });
+    unsigned int received = 0;
+    std::vector<std::shared_ptr<int>> items;
+    items.reserve(batch);
+    while (received < total_items) {
+        if (batch == 1) {
+            std::shared_ptr<int> item;
+            if (queue.dequeue_for(item, std::chrono::milliseconds(100))) received++;
+            continue;
+        }
+        items.clear();
+        unsigned int nb = queue.try_dequeue_bulk(std::back_inserter(items), batch);
+        if (nb) {
+            received += nb;
+            continue;
+        }
+        std::shared_ptr<int> item;
+        if (queue.dequeue_for(item, std::chrono::milliseconds(100))) received++;
+    }
+    producer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-begin;
+    return total_items/elapsed.count();
+}
+
+int main(int argc, char *argv[])
+{
+    double scale = benchmark_util::get_scale(argc, argv);
+    unsigned int single_items = benchmark_util::scaled(2000000, scale);
+    unsigned int contended_items = benchmark_util::scaled(500000, scale);
+    std::cout << "ff_queue_base / ff_safe_queue, latency in ns" << std::endl;
+    benchmark_util::print_header("items/s");
+    benchmark_util::print_row("base single-thread", run_single_thread_base(single_items));
+    benchmark_util::print_row("safe single-thread", run_single_thread_safe(single_items));
+    for (unsigned int producer_nb: {1, 2, 4}) {
+        ff_latency_histogram latency;
+        double rate = run_contended(producer_nb, contended_items, latency);
+        benchmark_util::print_row("safe contended " + std::to_string(producer_nb) + "p/1c", rate, &latency);
+    }
+    for (unsigned int batch: {1, 4, 16, 64, 128}) {
+        benchmark_util::print_row("safe batch " + std::to_string(batch), run_batched(batch, single_items));
+    }
+    return 0;
+}
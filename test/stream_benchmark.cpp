@@ -0,0 +1,69 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "ff_stream_base.h"
+#include "benchmark_util.h"
+
+using namespace FFPlayer;
+
+static const unsigned int frame_sizes[] = {
+    4096,
+    64*1024,
+    400*300*3,
+    1920*1080*3
+};
+
+static unsigned int frames_for(unsigned int frame_size, double scale) {
+    return benchmark_util::scaled(std::max(16u, (unsigned int)(512ull*1024*1024/frame_size)), scale);
+}
+
+static double run_single_thread(unsigned int frame_size, unsigned int frame_nb) {
+    ff_stream_base<uint8_t> stream(frame_size*4, frame_size);
+    std::vector<uint8_t> in(frame_size, 1), out(frame_size);
+    stream.append(in.data(), frame_size);
+    unsigned long long begin = benchmark_util::now_ns();
+    for (unsigned int i = 0; i < frame_nb; i++) {
+        stream.append(in.data(), frame_size);
+        stream.consume(out.data(), frame_size);
+    }
+    double seconds = (benchmark_util::now_ns()-begin)/1e9;
+    return (double)frame_size*frame_nb/seconds/(1024*1024);
+}
+
+static double run_contended(unsigned int frame_size, unsigned int frame_nb, ff_latency_histogram& latency) {
+    ff_safe_stream<uint8_t> stream(frame_size*4, frame_size);
+    unsigned long long begin = benchmark_util::now_ns();
+    std::thread producer([&stream, frame_size, frame_nb](){
+        std::vector<uint8_t> in(frame_size, 1);
+        for (unsigned int i = 0; i <= frame_nb; i++) {
+            if (!stream.append(in.data(), frame_size)) break;
+        }
+    });
+    std::vector<uint8_t> out(frame_size);
+    for (unsigned int i = 0; i < frame_nb; i++) {
+        unsigned long long start = benchmark_util::now_ns();
+        if (!stream.consume(out.data(), frame_size)) break;
+        latency.record(benchmark_util::now_ns()-start);
+    }
+    double seconds = (benchmark_util::now_ns()-begin)/1e9;
+    stream.cancel();
+    producer.join();
+    return (double)frame_size*frame_nb/seconds/(1024*1024);
+}
+
+int main(int argc, char *argv[])
+{
+    double scale = benchmark_util::get_scale(argc, argv);
+    std::cout << "ff_stream_base / ff_safe_stream, consume wait in ns" << std::endl;
+    benchmark_util::print_header("MB/s");
+    for (unsigned int frame_size: frame_sizes) {
+        benchmark_util::print_row("base append+consume " + std::to_string(frame_size),
+                                  run_single_thread(frame_size, frames_for(frame_size, scale)));
+    }
+    for (unsigned int frame_size: frame_sizes) {
+        ff_latency_histogram latency;
+        double rate = run_contended(frame_size, frames_for(frame_size, scale)/4, latency);
+        benchmark_util::print_row("safe 1p/1c " + std::to_string(frame_size), rate, &latency);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "task_pool_sync.h"
+#include "benchmark_util.h"
+
+using namespace FFPlayer;
+
+static const unsigned int pool_size = 50;
+
+static void close_pool(task_pool_sync& pool) {
+    std::atomic_bool closed(false);
+    pool.close([&closed](void*){closed.store(true);});
+    benchmark_util::wait_for(closed);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+static void submit(task_pool_sync& pool, std::function<void(void)> task) {
+    while (!pool.add_task(task)) std::this_thread::yield();
+}
+
+static double run_dispatch_latency(unsigned int task_nb, ff_latency_histogram& latency) {
+    task_pool_sync pool(pool_size);
+    pool.start();
+    unsigned long long begin = benchmark_util::now_ns();
+    for (unsigned int i = 0; i < task_nb; i++) {
+        std::atomic_bool done(false);
+        unsigned long long submitted = benchmark_util::now_ns();
+        submit(pool, [&done, &latency, submitted](){
+            latency.record(benchmark_util::now_ns()-submitted);
+            done.store(true);
+        });
+        benchmark_util::wait_for(done);
+    }
+    double rate = task_nb/((benchmark_util::now_ns()-begin)/1e9);
+    close_pool(pool);
+    return rate;
+}
+
+static double run_throughput(unsigned int submitter_nb, unsigned int task_nb, ff_latency_histogram& latency) {
+    task_pool_sync pool(pool_size);
+    pool.start();
+    unsigned int per_submitter = task_nb/submitter_nb;
+    task_nb = per_submitter*submitter_nb;
+    std::atomic_uint completed(0);
+    unsigned long long begin = benchmark_util::now_ns();
+    std::vector<std::thread> submitters;
+    for (unsigned int s = 0; s < submitter_nb; s++) {
+        submitters.emplace_back([&pool, &completed, &latency, per_submitter](){
+            for (unsigned int i = 0; i < per_submitter; i++) {
+                unsigned long long submitted = benchmark_util::now_ns();
+                submit(pool, [&completed, &latency, submitted](){
+                    latency.record(benchmark_util::now_ns()-submitted);
+                    completed.fetch_add(1);
+                });
+            }
+        });
+    }
+    for (auto& t: submitters) t.join();
+    while (completed.load() < task_nb) std::this_thread::yield();
+    double rate = task_nb/((benchmark_util::now_ns()-begin)/1e9);
+    close_pool(pool);
+    return rate;
+}
+
+int main(int argc, char *argv[])
+{
+    double scale = benchmark_util::get_scale(argc, argv);
+    unsigned int task_nb = benchmark_util::scaled(20000, scale);
+    std::cout << "task_pool_sync, submit-to-run latency in ns" << std::endl;
+    benchmark_util::print_header("tasks/s");
+    {
+        ff_latency_histogram latency;
+        double rate = run_dispatch_latency(task_nb, latency);
+        benchmark_util::print_row("dispatch one-in-flight", rate, &latency);
+    }
+    for (unsigned int submitter_nb: {1, 2, 4}) {
+        ff_latency_histogram latency;
+        double rate = run_throughput(submitter_nb, task_nb, latency);
+        benchmark_util::print_row("burst " + std::to_string(submitter_nb) + " submitters", rate, &latency);
+    }
+    return 0;
+}
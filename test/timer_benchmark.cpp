@@ -0,0 +1,50 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include "ff_asyn_timer.h"
+#include "benchmark_util.h"
+
+using namespace FFPlayer;
+
+static double run_jitter(unsigned int ms, unsigned int tick_nb, ff_latency_histogram& jitter) {
+    std::atomic_uint ticks(0);
+    std::atomic_bool closed(false);
+    unsigned long long last = 0;
+    unsigned long long first = 0;
+    unsigned long long period = ms*1000000ull;
+    ff_asyn_timer timer(ms, true, [&](void*) -> void* {
+        unsigned long long now = benchmark_util::now_ns();
+        if (last) {
+            unsigned long long interval = now-last;
+            jitter.record(interval > period ? interval-period : period-interval);
+        } else {
+            first = now;
+        }
+        last = now;
+        ticks.fetch_add(1);
+        return (void*)0;
+    });
+    timer.start();
+    while (ticks.load() < tick_nb) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    timer.cancel([&closed](ff_asyn_timer*){
+        closed.store(true);
+        return true;
+    });
+    benchmark_util::wait_for(closed);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return (last-first)/1e6/(ticks.load()-1);
+}
+
+int main(int argc, char *argv[])
+{
+    double scale = benchmark_util::get_scale(argc, argv);
+    unsigned int tick_nb = benchmark_util::scaled(500, scale);
+    std::cout << "ff_asyn_timer, |interval-period| jitter in ns" << std::endl;
+    benchmark_util::print_header("mean ms");
+    for (unsigned int ms: {1, 5, 10}) {
+        ff_latency_histogram jitter;
+        double mean = run_jitter(ms, tick_nb, jitter);
+        benchmark_util::print_row("period " + std::to_string(ms) + "ms", mean, &jitter);
+    }
+    return 0;
+}